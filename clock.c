@@ -1,6 +1,6 @@
 /* 
- * clock.c - Routines for using the cycle counters on x86, 
- *           Alpha, and Sparc boxes.
+ * clock.c - Routines for using the cycle counters on x86, x86-64,
+ *           aarch64, Alpha, and Sparc boxes.
  * 
  * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
  * May not be used, modified, or copied without permission.
@@ -8,7 +8,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/times.h>
 #include "clock.h"
 
@@ -16,7 +18,7 @@
 /******************************************************* 
  * Machine dependent functions 
  *
- * Note: the constants __i386__ and  __alpha
+ * Note: the constants __i386__, __x86_64__, __aarch64__ and  __alpha
  * are set by GCC when it calls the C preprocessor
  * You can verify this for yourself using gcc -v.
  *******************************************************/
@@ -71,6 +73,171 @@ double get_counter()
 }
 /* $end x86cyclecounter */
 
+#include <cpuid.h>
+
+/* Invariant TSC is reported in CPUID.80000007H:EDX[8] */
+int counter_invariant()
+{
+    unsigned eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+	return 0;
+    return (edx >> 8) & 1;
+}
+
+static double counter_nominal_mhz(void)
+{
+    return 0.0;
+}
+
+#elif defined(__x86_64__)
+/**********************************************************
+ * x86-64 versions of start_counter() and get_counter()
+ *
+ * The start of the measured region is read with "lfence; rdtsc" so
+ * that earlier instructions cannot drift past the read, and the end
+ * with "rdtscp; lfence" so that the measured code has retired before
+ * the read and later code cannot start early.  On the rare processors
+ * without rdtscp the end read falls back to "lfence; rdtsc".
+ **********************************************************/
+
+#include <cpuid.h>
+
+static uint64_t cyc_start = 0;
+static int have_rdtscp = -1;     /* -1 until probed with cpuid */
+
+static void probe_cpuid(void)
+{
+    unsigned eax, ebx, ecx, edx;
+
+    have_rdtscp = 0;
+    if (__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx))
+	have_rdtscp = (edx >> 27) & 1;
+}
+
+/* Serialized read for the start of a measured region */
+static inline uint64_t read_counter_start(void)
+{
+    unsigned hi, lo;
+
+    asm volatile("lfence; rdtsc" : "=d" (hi), "=a" (lo) : : "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* Serialized read for the end of a measured region */
+static inline uint64_t read_counter_end(void)
+{
+    unsigned hi, lo, aux;
+
+    if (have_rdtscp)
+	asm volatile("rdtscp; lfence"
+		     : "=d" (hi), "=a" (lo), "=c" (aux) : : "memory");
+    else
+	asm volatile("lfence; rdtsc; lfence"
+		     : "=d" (hi), "=a" (lo) : : "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* Set *hi and *lo to the high and low order bits of the cycle counter. */
+void access_counter(unsigned *hi, unsigned *lo)
+{
+    uint64_t now = read_counter_start();
+
+    *hi = (unsigned)(now >> 32);
+    *lo = (unsigned)now;
+}
+
+/* Record the current value of the cycle counter. */
+void start_counter()
+{
+    if (have_rdtscp < 0)
+	probe_cpuid();
+    cyc_start = read_counter_start();
+}
+
+/* Return the number of cycles since the last call to start_counter. */
+double get_counter()
+{
+    return (double)(read_counter_end() - cyc_start);
+}
+
+/* 
+ * counter_invariant - The TSC ticks at a constant rate across P-, C-
+ * and T-states only if CPUID.80000007H:EDX[8] (invariant TSC) is set.
+ */
+int counter_invariant()
+{
+    unsigned eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+	return 0;
+    return (edx >> 8) & 1;
+}
+
+/* The TSC rate is not architecturally visible; it must be calibrated. */
+static double counter_nominal_mhz(void)
+{
+    return 0.0;
+}
+
+#elif defined(__aarch64__)
+/**********************************************************
+ * aarch64 versions of start_counter() and get_counter()
+ *
+ * Uses the generic timer's virtual count register cntvct_el0, which
+ * every ARMv8 system exposes to user space.  An isb before the read
+ * keeps it from being speculated ahead of the measured code.  Note
+ * that this counter ticks at the fixed rate in cntfrq_el0 rather than
+ * at the core clock, so "cycles" here are counter ticks; mhz() returns
+ * the matching tick rate, so fsecs() still converts them correctly.
+ **********************************************************/
+
+static uint64_t cyc_start = 0;
+
+static inline uint64_t read_counter(void)
+{
+    uint64_t val;
+
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r" (val) : : "memory");
+    return val;
+}
+
+/* Set *hi and *lo to the high and low order bits of the counter. */
+void access_counter(unsigned *hi, unsigned *lo)
+{
+    uint64_t now = read_counter();
+
+    *hi = (unsigned)(now >> 32);
+    *lo = (unsigned)now;
+}
+
+/* Record the current value of the counter. */
+void start_counter()
+{
+    cyc_start = read_counter();
+}
+
+/* Return the number of counter ticks since the last call to start_counter. */
+double get_counter()
+{
+    return (double)(read_counter() - cyc_start);
+}
+
+/* The generic timer runs at a constant frequency by definition. */
+int counter_invariant()
+{
+    return 1;
+}
+
+/* The frequency of the generic timer is published in cntfrq_el0. */
+static double counter_nominal_mhz(void)
+{
+    uint64_t freq;
+
+    asm volatile("mrs %0, cntfrq_el0" : "=r" (freq));
+    return (double)freq / 1e6;
+}
+
 #elif defined(__alpha)
 
 /****************************************************
@@ -133,6 +300,17 @@ double get_counter()
     return result;
 }
 
+/* rpcc counts processor cycles at the fixed core clock */
+int counter_invariant()
+{
+    return 1;
+}
+
+static double counter_nominal_mhz(void)
+{
+    return 0.0;
+}
+
 #else
 
 /****************************************************************
@@ -158,6 +336,16 @@ double get_counter()
     printf("Please choose another timing package in config.h.\n");
     exit(1);
 }
+
+int counter_invariant()
+{
+    return 0;
+}
+
+static double counter_nominal_mhz(void)
+{
+    return 0.0;
+}
 #endif
 
 
@@ -185,20 +373,97 @@ double ovhd()
 double mhz_full(int verbose, int sleeptime)
 {
     double rate;
-
+    struct timespec req, t0, t1;
+
+    /* 
+     * Time the sleep against the monotonic clock rather than trusting
+     * sleep() to return after exactly sleeptime seconds.
+     */
+    req.tv_sec = sleeptime;
+    req.tv_nsec = 0;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &t0);
     start_counter();
-    sleep(sleeptime);
-    rate = get_counter() / (1e6*sleeptime);
+    nanosleep(&req, NULL);
+    rate = get_counter();
+    clock_gettime(CLOCK_MONOTONIC_RAW, &t1);
+    rate /= 1e6 * ((t1.tv_sec - t0.tv_sec) + 1e-9*(t1.tv_nsec - t0.tv_nsec));
     if (verbose) 
 	printf("Processor clock rate ~= %.1f MHz\n", rate);
     return rate;
 }
 /* $end mhz */
 
-/* Version using a default sleeptime */
+#define CALIB_WINDOWS 7      /* number of calibration windows */
+#define CALIB_NSECS   5000000 /* length of each window (5 ms) */
+
+/*
+ * Read the monotonic clock and the counter as close together as
+ * possible.  The pair is retried until both reads land within a
+ * short interval, so an interrupt between them cannot skew a window.
+ */
+static double paired_read(double *cyc)
+{
+    struct timespec a, b;
+    double c, best = -1, span, ns = 0;
+    int i;
+
+    for (i = 0; i < 5; i++) {
+	clock_gettime(CLOCK_MONOTONIC_RAW, &a);
+	c = get_counter();
+	clock_gettime(CLOCK_MONOTONIC_RAW, &b);
+	span = (b.tv_sec - a.tv_sec)*1e9 + (b.tv_nsec - a.tv_nsec);
+	if (best < 0 || span < best) {
+	    best = span;
+	    *cyc = c;
+	    ns = a.tv_sec*1e9 + a.tv_nsec + span/2;
+	    if (span < 1000)
+		break;
+	}
+    }
+    return ns;
+}
+
+/* 
+ * mhz_calibrate - Estimate the counter rate by spinning for several
+ * short windows against CLOCK_MONOTONIC_RAW and taking the median of
+ * the per-window rates.  Spinning keeps the core out of deep sleep, so
+ * even a non-invariant counter is measured at its running rate.
+ */
+static double mhz_calibrate(void)
+{
+    double rates[CALIB_WINDOWS];
+    double c0, c1, ns0, ns1, tmp;
+    int i, j;
+
+    start_counter();
+    for (i = 0; i < CALIB_WINDOWS; i++) {
+	ns0 = paired_read(&c0);
+	do {
+	    ns1 = paired_read(&c1);
+	} while (ns1 - ns0 < CALIB_NSECS);
+	rates[i] = (c1 - c0) / ((ns1 - ns0) * 1e-3);
+    }
+
+    /* Insertion sort; the window count is tiny */
+    for (i = 1; i < CALIB_WINDOWS; i++)
+	for (j = i; j > 0 && rates[j-1] > rates[j]; j--) {
+	    tmp = rates[j-1];
+	    rates[j-1] = rates[j];
+	    rates[j] = tmp;
+	}
+    return rates[CALIB_WINDOWS/2];
+}
+
+/* Version using a calibrated estimate instead of a long sleep */
 double mhz(int verbose)
 {
-    return mhz_full(verbose, 2);
+    double rate;
+
+    if ((rate = counter_nominal_mhz()) == 0.0)
+	rate = mhz_calibrate();
+    if (verbose) 
+	printf("Processor clock rate ~= %.1f MHz\n", rate);
+    return rate;
 }
 
 /** Special counters that compensate for timer interrupt overhead */
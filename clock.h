@@ -9,12 +9,15 @@ double get_counter();
 /* Measure overhead for counter */
 double ovhd();
 
-/* Determine clock rate of processor (using a default sleeptime) */
+/* Determine clock rate of processor (using a short calibration) */
 double mhz(int verbose);
 
 /* Determine clock rate of processor, having more control over accuracy */
 double mhz_full(int verbose, int sleeptime);
 
+/* Does the counter tick at a constant rate regardless of power state? */
+int counter_invariant();
+
 /** Special counters that compensate for timer interrupt overhead */
 
 void start_comp_counter();
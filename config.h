@@ -34,17 +34,6 @@
   "realloc-bal.rep",\
   "realloc2-bal.rep"
 
-/*
- * This constant gives the estimated performance of the libc malloc
- * package using our traces on some reference system, typically the
- * same kind of system the students use. Its purpose is to cap the
- * contribution of throughput to the performance index. Once the
- * students surpass the AVG_LIBC_THRUPUT, they get no further benefit
- * to their score.  This deters students from building extremely fast,
- * but extremely stupid malloc packages.
- */
-#define AVG_LIBC_THRUPUT      10750E3  /* 10,750 Kops/sec */
-
  /* 
   * This constant determines the contributions of space utilization
   * (UTIL_WEIGHT) and throughput (1 - UTIL_WEIGHT) to the performance
@@ -58,15 +47,72 @@
 #define ALIGNMENT 8
 
 /* 
- * Maximum heap size in bytes 
+ * Maximum heap size in bytes (builds that replace the process malloc,
+ * like libmm.so, define a larger one on the command line)
  */
+#ifndef MAX_HEAP
 #define MAX_HEAP (20*(1<<20))  /* 20 MB */
+#endif
 
 /*****************************************************************************
  * Set exactly one of these USE_xxx constants to "1" to select a timing method
  *****************************************************************************/
-#define USE_FCYC   0   /* cycle counter w/K-best scheme (x86 & Alpha only) */
+#define USE_FCYC   0   /* cycle counter w/K-best scheme (x86, x86-64, aarch64 & Alpha) */
 #define USE_ITIMER 0   /* interval timer (any Unix box) */
-#define USE_GETTOD 1   /* gettimeofday (any Unix box) */
+#define USE_GETTOD 0   /* gettimeofday (any Unix box) */
+#define USE_ROBUST 1   /* monotonic clock w/adaptive runs and robust stats */
+
+/*
+ * Parameters of the USE_ROBUST timing harness (see ftimer_robust)
+ */
+#define BENCH_WARMUP      2       /* discarded warmup runs */
+#define BENCH_MIN_RUNS    5       /* never stop with fewer samples kept */
+#define BENCH_MAX_RUNS    200     /* never take more samples */
+#define BENCH_MIN_SAMPLE  1e-3    /* each sample lasts at least this (secs) */
+#define BENCH_REL_CI      0.01    /* stop when the median's 95% CI is +/- 1% */
+#define BENCH_MAX_SECS    2.0     /* time budget per measurement (secs) */
+
+/*
+ * Number of interleaved runs of each build in the A/B comparison (-A)
+ */
+#define AB_ROUNDS 10
+
+/*
+ * Parameters of the autotuner (-u): random and hill-climbing searches
+ * evaluate at most TUNE_BUDGET configurations, of TUNE_LEVELS levels
+ * per parameter (see tune_params in mdriver.c)
+ */
+#define TUNE_BUDGET 24
+#define TUNE_LEVELS 4
+
+/*
+ * Number of runs of each trace over which mdriver -v takes every
+ * request's fastest time, for the worst-case latency columns
+ */
+#define LATENCY_RUNS 5
+
+/*
+ * Parameters of the threaded cache benchmark (-b): each thread makes
+ * CACHE_BENCH_OPS requests of CACHE_BENCH_MIN..CACHE_BENCH_MAX bytes,
+ * keeping at most CACHE_BENCH_LIVE blocks live
+ */
+#define CACHE_BENCH_OPS   20000
+#define CACHE_BENCH_LIVE  32
+#define CACHE_BENCH_MIN   16
+#define CACHE_BENCH_MAX   256
+
+/*
+ * Parameters of the NUMA remote-access benchmark (-N): a randomly
+ * linked list of NUMA_BENCH_BYTES in one-cache-line blocks is walked
+ * for NUMA_BENCH_STEPS steps
+ */
+#define NUMA_BENCH_BYTES  (64 << 20)
+#define NUMA_BENCH_STEPS  (1 << 24)
+
+/*
+ * Iterations per thread of the false-sharing benchmark (-F), in which
+ * each thread bumps the counters in its own 64-byte block
+ */
+#define SHARE_BENCH_ITERS 20000000
 
 #endif /* __CONFIG_H */
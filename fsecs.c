@@ -26,16 +26,31 @@ void init_fsecs(void)
     /* set key parameters for the fcyc package */
     set_fcyc_maxsamples(20); 
     set_fcyc_clear_cache(1);
+#if defined(__x86_64__) || defined(__aarch64__)
+    /* 
+     * Tick compensation calibrates against times(), whose own cost
+     * exceeds the callibrate() threshold on current kernels and makes
+     * it spin for seconds.  Tickless kernels don't need it anyway.
+     */
+    set_fcyc_compensate(0);
+#else
     set_fcyc_compensate(1);
+#endif
     set_fcyc_epsilon(0.01);
     set_fcyc_k(3);
     Mhz = mhz(verbose > 0);
+    if (!counter_invariant())
+	printf("Warning: the cycle counter rate varies with CPU frequency.\n"
+	       "Consider USE_GETTOD in config.h on this machine.\n");
 #elif USE_ITIMER
     if (verbose)
 	printf("Measuring performance with the interval timer.\n");
 #elif USE_GETTOD
     if (verbose)
 	printf("Measuring performance with gettimeofday().\n");
+#elif USE_ROBUST
+    if (verbose)
+	printf("Measuring performance with the adaptive robust timer.\n");
 #endif
 }
 
@@ -44,6 +59,21 @@ void init_fsecs(void)
  */
 double fsecs(fsecs_test_funct f, void *argp) 
 {
+    return fsecs_stats(f, argp, NULL);
+}
+
+/*
+ * fsecs_stats - Return the running time of a function f (in seconds).
+ *     With USE_ROBUST the sample statistics go to *st; the other
+ *     timing methods report st->runs == 0.
+ */
+double fsecs_stats(fsecs_test_funct f, void *argp, fstats_t *st) 
+{
+#if USE_ROBUST
+    return ftimer_robust(f, argp, st);
+#else
+    if (st != NULL)
+	st->runs = 0;
 #if USE_FCYC
     double cycles = fcyc(f, argp);
     return cycles/(Mhz*1e6);
@@ -52,6 +82,18 @@ double fsecs(fsecs_test_funct f, void *argp)
 #elif USE_GETTOD
     return ftimer_gettod(f, argp, 10);
 #endif 
+#endif 
 }
 
 
+
+/*
+ * fsecs_counters - Return the hardware event counts of one run of a
+ *     function f, averaged over several runs to smooth out start-up
+ *     effects
+ */
+void fsecs_counters(fsecs_test_funct f, void *argp, fcounts_t *c)
+{
+    f(argp); /* warm up */
+    ftimer_counters(f, argp, 10, c);
+}
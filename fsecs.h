@@ -1,4 +1,9 @@
+#include "fstats.h"
+#include "ftimer.h"
+
 typedef void (*fsecs_test_funct)(void *);
 
 void init_fsecs(void);
 double fsecs(fsecs_test_funct f, void *argp);
+double fsecs_stats(fsecs_test_funct f, void *argp, fstats_t *st);
+void fsecs_counters(fsecs_test_funct f, void *argp, fcounts_t *c);
@@ -0,0 +1,177 @@
+/*
+ * fstats.c - Robust summary statistics for timing samples
+ *
+ * Timing samples on a shared machine have a long right tail (page
+ * faults, interrupts, migrations), so we summarize them with the
+ * median and the median absolute deviation rather than the mean, and
+ * give a distribution-free confidence interval for the median from
+ * the order statistics.
+ */
+#include <stdlib.h>
+#include <math.h>
+
+#include "fstats.h"
+
+#define MAD_SCALE  1.4826 /* MAD -> standard deviation for normal data */
+#define OUTLIER_Z  3.5    /* reject samples with a larger modified z-score */
+#define ALPHA_95   0.05   /* the CI misses the median at most this often */
+
+/* 
+ * cmp_double - qsort comparator for doubles 
+ */
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* 
+ * median_sorted - median of n sorted samples 
+ */
+static double median_sorted(const double *x, int n)
+{
+    if (n == 0)
+	return 0.0;
+    return (n % 2) ? x[n/2] : (x[n/2 - 1] + x[n/2]) / 2;
+}
+
+/* 
+ * mad_sorted - median absolute deviation of n sorted samples about med 
+ */
+static double mad_sorted(const double *x, int n, double med)
+{
+    double *dev;
+    double mad;
+    int i;
+
+    if (n == 0 || (dev = malloc(n * sizeof(double))) == NULL)
+	return 0.0;
+    for (i = 0; i < n; i++)
+	dev[i] = fabs(x[i] - med);
+    qsort(dev, n, sizeof(double), cmp_double);
+    mad = median_sorted(dev, n);
+    free(dev);
+    return mad;
+}
+
+/*
+ * fstats_summarize - Sort the samples, drop the outliers, and compute
+ *     the median, MAD, and a 95% confidence interval of the median
+ */
+void fstats_summarize(double *x, int n, fstats_t *st)
+{
+    double med, mad, p, tail;
+    int lo, hi, k;
+
+    qsort(x, n, sizeof(double), cmp_double);
+    med = median_sorted(x, n);
+    mad = mad_sorted(x, n, med);
+
+    /* Outliers sit at the ends of the sorted array, so trim both ends */
+    lo = 0;
+    hi = n;
+    if (mad > 0) {
+	while (lo < hi && (med - x[lo]) / (MAD_SCALE * mad) > OUTLIER_Z)
+	    lo++;
+	while (hi > lo && (x[hi-1] - med) / (MAD_SCALE * mad) > OUTLIER_Z)
+	    hi--;
+    }
+    st->outliers = n - (hi - lo);
+    n = hi - lo;
+    x += lo;
+
+    st->runs = n;
+    st->median = median_sorted(x, n);
+    st->mad = mad_sorted(x, n, st->median);
+
+    /* 
+     * x[k]..x[n-1-k] misses the median when k+1 or fewer samples fall
+     * on one side of it, which has probability 2 P(B <= k) for B
+     * binomial(n, 1/2).  Take the largest k that keeps this within
+     * ALPHA_95; with fewer than 6 samples there is none.
+     */
+    st->ci = 0;
+    st->ci_lo = (n > 0) ? x[0] : 0.0;
+    st->ci_hi = (n > 0) ? x[n-1] : 0.0;
+    p = ldexp(1.0, -n);		/* P(B == k) */
+    tail = p;			/* P(B <= k) */
+    for (k = 0; k < n / 2 && 2 * tail <= ALPHA_95; k++) {
+	st->ci = 1;
+	st->ci_lo = x[k];
+	st->ci_hi = x[n-1-k];
+	p = p * (n - k) / (k + 1);
+	tail += p;
+    }
+}
+
+/*
+ * fstats_mannwhitney - Rank the pooled samples (ties get their average
+ *     rank), form the U statistic for a, and return the two-sided
+ *     p-value from its normal approximation with tie correction.
+ */
+double fstats_mannwhitney(const double *a, int na, const double *b, int nb)
+{
+    double *pool, *rank;
+    int *from_a;
+    double ra = 0, u, mu, sigma2, ties = 0, z;
+    int n = na + nb;
+    int i, j, k;
+
+    if (na == 0 || nb == 0)
+	return 1.0;
+    pool = malloc(n * sizeof(double));
+    rank = malloc(n * sizeof(double));
+    from_a = malloc(n * sizeof(int));
+    if (pool == NULL || rank == NULL || from_a == NULL) {
+	free(pool);
+	free(rank);
+	free(from_a);
+	return 1.0;
+    }
+
+    /* Merge a and b in sorted order, remembering where each came from */
+    for (i = 0; i < na; i++)
+	pool[i] = a[i];
+    for (i = 0; i < nb; i++)
+	pool[na + i] = b[i];
+    for (i = 0; i < n; i++)
+	from_a[i] = (i < na);
+    for (i = 1; i < n; i++) {
+	double v = pool[i];
+	int f = from_a[i];
+	for (j = i; j > 0 && pool[j-1] > v; j--) {
+	    pool[j] = pool[j-1];
+	    from_a[j] = from_a[j-1];
+	}
+	pool[j] = v;
+	from_a[j] = f;
+    }
+
+    /* Assign ranks (origin 1), averaging over runs of ties */
+    for (i = 0; i < n; i = j) {
+	for (j = i + 1; j < n && pool[j] == pool[i]; j++)
+	    ;
+	for (k = i; k < j; k++)
+	    rank[k] = (i + j + 1) / 2.0;
+	ties += (double)(j - i) * (j - i) * (j - i) - (j - i);
+    }
+    for (i = 0; i < n; i++)
+	if (from_a[i])
+	    ra += rank[i];
+
+    u = ra - (double)na * (na + 1) / 2;
+    mu = (double)na * nb / 2;
+    sigma2 = (double)na * nb / 12 * ((n + 1) - ties / ((double)n * (n - 1)));
+
+    free(pool);
+    free(rank);
+    free(from_a);
+
+    if (sigma2 <= 0)
+	return 1.0;
+    z = (fabs(u - mu) - 0.5) / sqrt(sigma2);
+    if (z < 0)
+	z = 0;
+    return erfc(z / sqrt(2.0));
+}
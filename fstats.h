@@ -0,0 +1,30 @@
+/*
+ * fstats.h - Robust summary statistics for timing samples
+ */
+#ifndef __FSTATS_H_
+#define __FSTATS_H_
+
+/* Summary of a set of timing samples */
+typedef struct {
+    int runs;       /* samples kept after outlier rejection (0 = no stats) */
+    int outliers;   /* samples rejected as outliers */
+    double median;  /* median of the kept samples */
+    double mad;     /* median absolute deviation of the kept samples */
+    int ci;         /* 1 if there are enough samples for a 95% CI */
+    double ci_lo;   /* lower end of the 95% confidence interval of median */
+    double ci_hi;   /* upper end of the 95% confidence interval of median */
+} fstats_t;
+
+/* 
+ * Summarize the n samples in x (sorted in place), rejecting outliers
+ * whose modified z-score exceeds 3.5.
+ */
+void fstats_summarize(double *x, int n, fstats_t *st);
+
+/* 
+ * Two-sided p-value of the Mann-Whitney U test that the samples in a
+ * and b come from the same distribution.
+ */
+double fstats_mannwhitney(const double *a, int na, const double *b, int nb);
+
+#endif /* __FSTATS_H_ */
@@ -7,10 +7,25 @@
  * Function timers that estimate the running time (in seconds) of a function f.
  *    ftimer_itimer: version that uses the interval timer
  *    ftimer_gettod: version that uses gettimeofday
+ *    ftimer_robust: adaptive version that reports robust statistics
+ *
+ * ftimer_counters additionally reads the hardware performance counters
+ * (through perf_event_open on Linux) around runs of f.
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
 #include <sys/time.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
 #include "ftimer.h"
+#include "config.h"
 
 /* function prototypes */
 static void init_etime(void);
@@ -52,6 +67,206 @@ double ftimer_gettod(ftimer_test_funct f, void *argp, int n)
     return (1E-3*diff);
 }
 
+/* 
+ * now_secs - Read the monotonic clock in seconds 
+ */
+static double now_secs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* 
+ * time_reps - Return the average running time of reps back-to-back
+ * calls to f(argp).
+ */
+static double time_reps(ftimer_test_funct f, void *argp, int reps)
+{
+    double start;
+    int i;
+
+    start = now_secs();
+    for (i = 0; i < reps; i++)
+	f(argp);
+    return (now_secs() - start) / reps;
+}
+
+/* 
+ * ftimer_robust - Estimate the running time of f(argp) from repeated
+ * samples.  After BENCH_WARMUP discarded runs, each sample times enough
+ * back-to-back calls to last at least BENCH_MIN_SAMPLE seconds, and
+ * samples are taken until the 95% confidence interval of the median
+ * is within BENCH_REL_CI of the median, BENCH_MAX_RUNS samples have
+ * been taken, or BENCH_MAX_SECS seconds have elapsed.  The interval
+ * only counts once BENCH_MIN_RUNS samples are left after outlier
+ * rejection and there are enough of them for a 95% CI.  Returns the
+ * median after outlier rejection; the full summary goes to *st if it
+ * is not NULL.
+ */
+double ftimer_robust(ftimer_test_funct f, void *argp, fstats_t *st)
+{
+    double samples[BENCH_MAX_RUNS], sorted[BENCH_MAX_RUNS];
+    double t, deadline;
+    fstats_t stats;
+    int reps, n, i;
+
+    /* Warm the caches and size each sample from the warmup runs */
+    t = 0;
+    for (i = 0; i < BENCH_WARMUP; i++)
+	t = time_reps(f, argp, 1);
+    reps = 1;
+    if (t > 0 && t < BENCH_MIN_SAMPLE)
+	reps = (int)(BENCH_MIN_SAMPLE / t) + 1;
+
+    deadline = now_secs() + BENCH_MAX_SECS;
+    for (n = 0; n < BENCH_MAX_RUNS; ) {
+	samples[n++] = time_reps(f, argp, reps);
+	if (n < BENCH_MIN_RUNS)
+	    continue;
+
+	/* fstats_summarize sorts its input, so hand it a copy */
+	for (i = 0; i < n; i++)
+	    sorted[i] = samples[i];
+	fstats_summarize(sorted, n, &stats);
+	if (stats.runs >= BENCH_MIN_RUNS && stats.ci &&
+	    (stats.ci_hi - stats.ci_lo) / 2 <= BENCH_REL_CI * stats.median)
+	    break;
+	if (now_secs() > deadline)
+	    break;
+    }
+
+    if (st != NULL)
+	*st = stats;
+    return stats.median;
+}
+
+
+/*
+ * Routines for reading the hardware performance counters
+ */
+
+/* Names of the counters, in the order of the fcounts_t arrays */
+const char *ftimer_counter_names[FTIMER_NCOUNTERS] = {
+    "cycles", "instrs", "L1d-miss", "LLC-miss", "dTLB-miss", "br-miss"
+};
+
+#ifdef __linux__
+
+#define HW_CACHE(cache, op, result) \
+    ((cache) | ((op) << 8) | ((result) << 16))
+
+/* perf_event_attr type and config for each counter */
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} counter_spec[FTIMER_NCOUNTERS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, HW_CACHE(PERF_COUNT_HW_CACHE_L1D,
+				   PERF_COUNT_HW_CACHE_OP_READ,
+				   PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HW_CACHE, HW_CACHE(PERF_COUNT_HW_CACHE_DTLB,
+				   PERF_COUNT_HW_CACHE_OP_READ,
+				   PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+static int counter_fd[FTIMER_NCOUNTERS];
+static int counters_opened = 0;
+
+/* 
+ * ftimer_counters_open - Open one user-space-only counting event per
+ * counter.  Events are opened individually rather than as a group so
+ * that a counter the PMU or the kernel refuses (perf_event_paranoid,
+ * containers, VMs without a virtual PMU) only disables itself.
+ * Returns the number of counters that are available.
+ */
+int ftimer_counters_open(void)
+{
+    struct perf_event_attr attr;
+    int i, n = 0;
+
+    if (counters_opened) {
+	for (i = 0; i < FTIMER_NCOUNTERS; i++)
+	    n += (counter_fd[i] >= 0);
+	return n;
+    }
+    counters_opened = 1;
+
+    for (i = 0; i < FTIMER_NCOUNTERS; i++) {
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = counter_spec[i].type;
+	attr.config = counter_spec[i].config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+	    PERF_FORMAT_TOTAL_TIME_RUNNING;
+	counter_fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+	n += (counter_fd[i] >= 0);
+    }
+    return n;
+}
+
+/* 
+ * ftimer_counters - Run f(argp) n times with the counters enabled and
+ * store the per-run counts in *c.  Counts of counters that were
+ * multiplexed with other events are scaled up by enabled/running time.
+ */
+void ftimer_counters(ftimer_test_funct f, void *argp, int n, fcounts_t *c)
+{
+    uint64_t buf[3];
+    int i;
+
+    ftimer_counters_open();
+    for (i = 0; i < FTIMER_NCOUNTERS; i++) {
+	c->valid[i] = 0;
+	c->val[i] = 0;
+	if (counter_fd[i] >= 0) {
+	    ioctl(counter_fd[i], PERF_EVENT_IOC_RESET, 0);
+	    ioctl(counter_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+    }
+
+    for (i = 0; i < n; i++)
+	f(argp);
+
+    for (i = 0; i < FTIMER_NCOUNTERS; i++) {
+	if (counter_fd[i] < 0)
+	    continue;
+	ioctl(counter_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+	if (read(counter_fd[i], buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0)
+	    continue;
+	c->valid[i] = 1;
+	c->val[i] = (double)buf[0] * ((double)buf[1] / buf[2]) / n;
+    }
+}
+
+#else /* !__linux__ */
+
+int ftimer_counters_open(void)
+{
+    return 0;
+}
+
+void ftimer_counters(ftimer_test_funct f, void *argp, int n, fcounts_t *c)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+	f(argp);
+    for (i = 0; i < FTIMER_NCOUNTERS; i++) {
+	c->valid[i] = 0;
+	c->val[i] = 0;
+    }
+}
+
+#endif /* __linux__ */
+
 
 /*
  * Routines for manipulating the Unix interval timer
@@ -1,6 +1,11 @@
+#ifndef __FTIMER_H_
+#define __FTIMER_H_
+
 /* 
  * Function timers 
  */
+#include "fstats.h"
+
 typedef void (*ftimer_test_funct)(void *); 
 
 /* Estimate the running time of f(argp) using the Unix interval timer.
@@ -12,3 +17,29 @@ double ftimer_itimer(ftimer_test_funct f, void *argp, int n);
    Return the average of n runs */
 double ftimer_gettod(ftimer_test_funct f, void *argp, int n);
 
+
+/* Estimate the running time of f(argp) with warmup, an adaptive number
+   of runs and outlier rejection. Return the median and fill in *st */
+double ftimer_robust(ftimer_test_funct f, void *argp, fstats_t *st);
+
+/* 
+ * Hardware performance counters 
+ */
+#define FTIMER_NCOUNTERS 6
+
+/* Per-run event counts; valid[i] is 0 if counter i is unavailable */
+typedef struct {
+    int valid[FTIMER_NCOUNTERS];
+    double val[FTIMER_NCOUNTERS];
+} fcounts_t;
+
+/* Short names of the counters, e.g. for table headings */
+extern const char *ftimer_counter_names[FTIMER_NCOUNTERS];
+
+/* Open the counters. Return the number that the system lets us use */
+int ftimer_counters_open(void);
+
+/* Run f(argp) n times and return the average counts per run in *c */
+void ftimer_counters(ftimer_test_funct f, void *argp, int n, fcounts_t *c);
+
+#endif /* __FTIMER_H_ */
@@ -7,6 +7,7 @@
  * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
  * May not be used, modified, or copied without permission.
  */
+#define _GNU_SOURCE /* CPU affinity for the NUMA benchmark */
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,8 +17,16 @@
 #include <assert.h>
 #include <float.h>
 #include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <linux/mempolicy.h>
 
 #include "mm.h"
+#include "mmengine.h"
+#include "mmcache.h"
 #include "memlib.h"
 #include "fsecs.h"
 #include "config.h"
@@ -34,6 +43,8 @@
 /* Returns true if p is ALIGNMENT-byte aligned */
 #define IS_ALIGNED(p)  ((((uintptr_t)(p)) % ALIGNMENT) == 0)
 
+#define MAX(x, y)  ((x) > (y) ? (x) : (y))
+
 /****************************** 
  * The key compound data types 
  *****************************/
@@ -82,17 +93,52 @@ typedef struct {
 
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
+    double ifrag;    /* unrequested share of the usable payload at the peak */
+    size_t sbrks;    /* mem_sbrk calls that grew the heap (0 for libc) */
+
+    fstats_t tstats; /* sample statistics behind secs (if tstats.runs > 0) */
+    fcounts_t counts; /* hardware event counts per run of the trace (-p) */
+    double min_util; /* lowest live/heap ratio in the timeline (-T) */
+    int min_util_op; /* ... and the request where it happened */
+    double max_ns;   /* slowest request in ns (-v; see eval_mm_latency) */
+    double p999_ns;  /* ... and the 99.9th percentile */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
 
+/* One configuration evaluated by the autotuner (-u) */
+typedef struct {
+    int level[3];    /* level of chunksize, split_min and nbins */
+    struct mm_params params;
+    int valid;       /* did every trace run correctly? */
+    double util;     /* average utilization over the traces */
+    double kops;     /* throughput over the traces (Kops) */
+    double score;    /* see tune_eval */
+} tune_t;
+
 /********************
  * Global variables
  *******************/
 int verbose = 0;        /* global flag for verbose output */
 static int errors = 0;  /* number of errs found when running student malloc */
+static int counters = 0; /* collect hardware performance counters (-p) */
+static int heapcheck = 0; /* run mm_checkheap after every request (-c) */
+static FILE *timeline = NULL; /* utilization timeline output (-T) */
+static int timeline_every = 0; /* requests between timeline samples (-T) */
+static char *timeline_trace;  /* name of the trace being sampled */
+static double timeline_min;   /* lowest live/heap ratio sampled so far */
+static int timeline_min_op;   /* ... and the request where it happened */
+static double util_ifrag;     /* internal fragmentation at the peak (see
+				 eval_mm_util) */
 char msg[MAXLINE];      /* for whenever we need to compose an error message */
 
+/* The mm.o this mdriver was linked with, as an engine (see mmengine.h) */
+static const mm_engine_t mm_engine = {
+    "mm", "mm.c as linked into this mdriver", mm_init, mm_malloc, mm_free,
+    mm_realloc, mm_usable_size, mm_stats, mm_checkheap
+};
+static const mm_engine_t *engine = &mm_engine; /* the engine under test */
+
 /* Directory where default tracefiles are found */
 static char tracedir[MAXLINE] = TRACEDIR;
 
@@ -124,10 +170,41 @@ static void eval_libc_speed(void *ptr);
    of the student's malloc package in mm.c */
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
+static void timeline_sample(int opnum, int total_size, int max_total_size);
 static void eval_mm_speed(void *ptr);
+static void eval_mm_latency(trace_t *trace, stats_t *stats);
+static void eval_mm(char **tracefiles, int num_tracefiles, stats_t *stats);
+static double eval_rss_util(trace_t *trace, int tracenum, range_t **ranges);
+static int engine_reset(void);
+static size_t usable_size(void *p, size_t size);
+static void touch(char *p, size_t size);
+static void rss_reset_peak(void);
+static size_t rss_field(const char *field);
+
+/* Run this build and another one interleaved and compare throughput */
+static void ab_compare(char *self, char *other, char **tracefiles, 
+		       int num_tracefiles);
+
+/* Threaded benchmark of the mmcache front ends */
+static void cache_bench(int nthreads);
+
+/* Access latency from each NUMA node's CPUs to each arena's memory */
+static void numa_bench(void);
+
+/* Scaling of per-thread counters with and without MM_NOSHARE */
+static void share_bench(int maxthreads);
+
+/* Search mm.c's run-time parameters for the best tradeoffs */
+static void autotune(char *search, char **tracefiles, int num_tracefiles,
+		     char *outfile);
 
 /* Various helper routines */
 static void printresults(int n, stats_t *stats);
+static void printengines(int n, int nengines, const mm_engine_t **engines,
+			 stats_t **stats);
+static void printtiming(int n, stats_t *stats);
+static void printtimeline(int n, char **tracefiles, stats_t *stats,
+			  char *file);
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
@@ -143,7 +220,6 @@ int main(int argc, char **argv)
     char **tracefiles = NULL;  /* null-terminated array of trace file names */
     int num_tracefiles = 0;    /* the number of traces in that array */
     trace_t *trace = NULL;     /* stores a single trace file in memory */
-    range_t *ranges = NULL;    /* keeps track of block extents for one trace */
     stats_t *libc_stats = NULL;/* libc stats for each trace */
     stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
     speed_t speed_params;      /* input parameters to the xx_speed routines */ 
@@ -151,29 +227,47 @@ int main(int argc, char **argv)
     int team_check = 1;  /* If set, check team structure (reset by -a) */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
     int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    int raw = 0;         /* If set, emit raw per-trace timings (-R) */
+    char *ab_other = NULL; /* Build to compare against (-A) */
+    int bench_threads = 0; /* Threads in the cache benchmark (-b) */
+    int bench_numa = 0;    /* Run the NUMA benchmark (-N) */
+    int bench_share = 0;   /* Threads in the false-sharing benchmark (-F) */
+    char *out_file = NULL;     /* Timeline or autotuner output (-o) */
+    char *tune_search = NULL;  /* Autotuner search method (-u) */
+    struct mm_params params;   /* mm.c's run-time parameters (-P) */
+    const mm_engine_t *engines[MM_ENGINE_MAX]; /* Engines to compare (-e) */
+    stats_t *engine_stats[MM_ENGINE_MAX];
+    int num_engines = 0;
+    int listed = 0;      /* If set, -e chose the engines */
+    char *name;
 
     /* temporaries used to compute the performance index */
     double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
+    double libc_secs, libc_ops, libc_throughput;
     int numcorrect;
     
+    /* The other engines registered themselves before main */
+    mm_engine_register(&mm_engine);
+
     /* 
      * Read and interpret the command line arguments 
      */
-    while ((c = getopt(argc, argv, "f:t:hvVgal")) != EOF) {
+    while ((c = getopt(argc, argv, "f:t:hvVgaclpRA:T:o:b:NF:e:d:P:u:")) != EOF) {
         switch (c) {
 	case 'g': /* Generate summary info for the autograder */
 	    autograder = 1;
 	    break;
-        case 'f': /* Use one specific trace file only (relative to curr dir) */
-            num_tracefiles = 1;
-            if ((tracefiles = realloc(tracefiles, 2*sizeof(char *))) == NULL)
+        case 'f': /* Use specific trace files only (relative to curr dir) */
+            num_tracefiles++;
+            if ((tracefiles = realloc(tracefiles, 
+				      (num_tracefiles+1)*sizeof(char *))) == NULL)
 		unix_error("ERROR: realloc failed in main");
 	    strcpy(tracedir, "./"); 
-            tracefiles[0] = strdup(optarg);
-            tracefiles[1] = NULL;
+            tracefiles[num_tracefiles-1] = strdup(optarg);
+            tracefiles[num_tracefiles] = NULL;
             break;
 	case 't': /* Directory where the traces are located */
-	    if (num_tracefiles == 1) /* ignore if -f already encountered */
+	    if (num_tracefiles > 0) /* ignore if -f already encountered */
 		break;
 	    strcpy(tracedir, optarg);
 	    if (tracedir[strlen(tracedir)-1] != '/') 
@@ -182,9 +276,77 @@ int main(int argc, char **argv)
         case 'a': /* Don't check team structure */
             team_check = 0;
             break;
+        case 'c': /* Check the heap after every request */
+            heapcheck = 1;
+            break;
         case 'l': /* Run libc malloc */
             run_libc = 1;
             break;
+        case 'p': /* Collect hardware performance counters */
+            counters = 1;
+            break;
+        case 'R': /* Emit raw per-trace timings for ab_compare */
+            raw = 1;
+            break;
+        case 'A': /* Compare throughput against another mdriver build */
+            ab_other = optarg;
+            break;
+        case 'e': /* Run the listed engines side by side */
+            for (name = strtok(optarg, ","); name != NULL; 
+		 name = strtok(NULL, ",")) {
+		if (num_engines == MM_ENGINE_MAX ||
+		    (engines[num_engines++] = mm_engine_find(name)) == NULL) {
+		    fprintf(stderr, "Unknown engine %s\n", name);
+		    usage();
+		    exit(1);
+		}
+	    }
+	    listed = 1;
+            break;
+        case 'd': /* Load an allocator from a shared object as an engine */
+            if (num_engines == MM_ENGINE_MAX ||
+		(engines[num_engines++] = mm_engine_load(optarg)) == NULL)
+		exit(1);
+            break;
+        case 'b': /* Run the threaded cache benchmark with optarg threads */
+            bench_threads = atoi(optarg);
+            if (bench_threads <= 0) {
+		usage();
+		exit(1);
+	    }
+            break;
+        case 'F': /* Run the false-sharing benchmark with up to optarg threads */
+            bench_share = atoi(optarg);
+            if (bench_share <= 0) {
+		usage();
+		exit(1);
+	    }
+            break;
+        case 'N': /* Run the NUMA remote-access benchmark */
+            bench_numa = 1;
+            break;
+        case 'T': /* Sample heap utilization every optarg requests */
+            timeline_every = atoi(optarg);
+            if (timeline_every <= 0) {
+		usage();
+		exit(1);
+	    }
+            break;
+        case 'o': /* File for the utilization timeline */
+            out_file = optarg;
+            break;
+        case 'P': /* Set mm.c's run-time parameters */
+            mm_get_params(&params);
+            if (mm_parse_params(optarg, &params) < 0 ||
+		mm_set_params(&params) < 0) {
+		fprintf(stderr, "Bad parameters %s\n", optarg);
+		usage();
+		exit(1);
+	    }
+            break;
+        case 'u': /* Autotune mm.c's parameters with search method optarg */
+            tune_search = optarg;
+            break;
         case 'v': /* Print per-trace performance breakdown */
             verbose = 1;
             break;
@@ -200,6 +362,20 @@ int main(int argc, char **argv)
         }
     }
 	
+    /* The timeline samples mm's heap statistics, which engines lack */
+    if (num_engines > 0 && timeline_every > 0) {
+	fprintf(stderr, "%s: -T can't be used with -e or -d\n", argv[0]);
+	usage();
+	exit(1);
+    }
+
+    /* Without -e, loaded engines are compared with mm */
+    if (num_engines > 0 && !listed && num_engines < MM_ENGINE_MAX) {
+	memmove(engines + 1, engines, num_engines * sizeof(engines[0]));
+	engines[0] = &mm_engine;
+	num_engines++;
+    }
+
     /* 
      * Check and print team info 
      */
@@ -226,6 +402,23 @@ int main(int argc, char **argv)
 	    printf("Member 2 :%s:%s\n", team.name2, team.id2);
     }
 
+    /* The cache benchmark replaces the trace runs */
+    if (bench_threads > 0) {
+	mem_init();
+	cache_bench(bench_threads);
+	exit(0);
+    }
+    if (bench_numa) {
+	mem_init();
+	numa_bench();
+	exit(0);
+    }
+    if (bench_share > 0) {
+	mem_init();
+	share_bench(bench_share);
+	exit(0);
+    }
+
     /* 
      * If no -f command line arg, then use the entire set of tracefiles 
      * defined in default_traces[]
@@ -236,13 +429,36 @@ int main(int argc, char **argv)
 	printf("Using default tracefiles in %s\n", tracedir);
     }
 
+    /* An A/B comparison runs both builds as child processes */
+    if (ab_other != NULL) {
+	ab_compare(argv[0], ab_other, tracefiles, num_tracefiles);
+	exit(0);
+    }
+
     /* Initialize the timing package */
     init_fsecs();
+    if (counters && ftimer_counters_open() == 0) {
+	printf("Hardware performance counters are unavailable "
+	       "(see /proc/sys/kernel/perf_event_paranoid); ignoring -p\n");
+	counters = 0;
+    }
+
+    /* The autotuner scores throughput against mm's own defaults */
+    if (tune_search != NULL) {
+	mem_init();
+	autotune(tune_search, tracefiles, num_tracefiles,
+		 out_file != NULL ? out_file : "mm-params.conf");
+	exit(0);
+    }
 
     /*
-     * Optionally run and evaluate the libc malloc package 
+     * Run and evaluate the libc malloc package (shown only with -l).
+     * Its throughput on this machine caps the throughput part of the
+     * performance index: going faster than libc earns nothing more,
+     * which deters extremely fast but extremely wasteful packages.
      */
-    if (run_libc) {
+    libc_throughput = 0;
+    if (run_libc || (num_engines == 0 && !raw)) {
 	if (verbose > 1)
 	    printf("\nTesting libc malloc\n");
 	
@@ -262,18 +478,51 @@ int main(int argc, char **argv)
 		speed_params.trace = trace;
 		if (verbose > 1)
 		    printf("and performance.\n");
-		libc_stats[i].secs = fsecs(eval_libc_speed, &speed_params);
+		libc_stats[i].secs = fsecs_stats(eval_libc_speed, &speed_params,
+						 &libc_stats[i].tstats);
+		if (counters)
+		    fsecs_counters(eval_libc_speed, &speed_params,
+				   &libc_stats[i].counts);
 	    }
 	    free_trace(trace);
 	}
 
+	libc_secs = libc_ops = 0;
+	for (i=0; i < num_tracefiles; i++) {
+	    if (libc_stats[i].valid) {
+		libc_secs += libc_stats[i].secs;
+		libc_ops += libc_stats[i].ops;
+	    }
+	}
+	if (libc_secs > 0)
+	    libc_throughput = libc_ops / libc_secs;
+
 	/* Display the libc results in a compact table */
-	if (verbose) {
+	if (run_libc && (verbose || counters)) {
 	    printf("\nResults for libc malloc:\n");
 	    printresults(num_tracefiles, libc_stats);
+	    printtiming(num_tracefiles, libc_stats);
 	}
     }
 
+    /*
+     * With -e, run each engine over the traces and compare them instead
+     */
+    if (num_engines > 0) {
+	mem_init();
+	for (i = 0; i < num_engines; i++) {
+	    engine_stats[i] = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
+	    if (engine_stats[i] == NULL)
+		unix_error("engine_stats calloc in main failed");
+	    engine = engines[i];
+	    if (verbose > 1)
+		printf("\nTesting engine %s\n", engine->name);
+	    eval_mm(tracefiles, num_tracefiles, engine_stats[i]);
+	}
+	printengines(num_tracefiles, num_engines, engines, engine_stats);
+	exit(0);
+    }
+
     /*
      * Always run and evaluate the student's mm package
      */
@@ -288,33 +537,45 @@ int main(int argc, char **argv)
     /* Initialize the simulated memory system in memlib.c */
     mem_init(); 
 
-    /* Evaluate student's mm malloc package using the K-best scheme */
-    for (i=0; i < num_tracefiles; i++) {
-	trace = read_trace(tracedir, tracefiles[i]);
-	mm_stats[i].ops = trace->num_ops;
-	if (verbose > 1)
-	    printf("Checking mm_malloc for correctness, ");
-	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges);
-	if (mm_stats[i].valid) {
-	    if (verbose > 1)
-		printf("efficiency, ");
-	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
-	    speed_params.trace = trace;
-	    speed_params.ranges = ranges;
-	    if (verbose > 1)
-		printf("and performance.\n");
-	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
-	}
-	free_trace(trace);
+    /* One CSV row per timeline sample; see timeline_sample */
+    if (timeline_every > 0) {
+	if (out_file == NULL)
+	    out_file = "timeline.csv";
+	if ((timeline = fopen(out_file, "w")) == NULL)
+	    unix_error("ERROR: could not open timeline file");
+	fprintf(timeline, "trace,op,live_bytes,heap_size,peak_heap_size,"
+		"util,alloc_blocks,free_bytes,free_blocks,largest_free,"
+		"ext_frag");
+	for (i = 0; i < MM_NBINS; i++)
+	    fprintf(timeline, ",bin%d_free_bytes", i);
+	fprintf(timeline, "\n");
     }
 
+    /* Evaluate student's mm malloc package using the K-best scheme */
+    eval_mm(tracefiles, num_tracefiles, mm_stats);
+
     /* Display the mm results in a compact table */
-    if (verbose) {
+    if (verbose || counters) {
 	printf("\nResults for mm malloc:\n");
 	printresults(num_tracefiles, mm_stats);
+	printtiming(num_tracefiles, mm_stats);
 	printf("\n");
     }
 
+    if (timeline != NULL) {
+	fclose(timeline);
+	printtimeline(num_tracefiles, tracefiles, mm_stats, out_file);
+    }
+
+    /* Raw per-trace timings, one line per trace, for ab_compare */
+    if (raw) {
+	for (i=0; i < num_tracefiles; i++)
+	    if (mm_stats[i].valid)
+		printf("raw %d %.0f %.9g\n", i, mm_stats[i].ops, 
+		       mm_stats[i].secs);
+	exit(0);
+    }
+
     /* 
      * Accumulate the aggregate statistics for the student's mm package 
      */
@@ -338,12 +599,12 @@ int main(int argc, char **argv)
 	avg_mm_throughput = ops/secs;
 
 	p1 = UTIL_WEIGHT * avg_mm_util;
-	if (avg_mm_throughput > AVG_LIBC_THRUPUT) {
+	if (avg_mm_throughput > libc_throughput) {
 	    p2 = (double)(1.0 - UTIL_WEIGHT);
 	} 
 	else {
 	    p2 = ((double) (1.0 - UTIL_WEIGHT)) * 
-		(avg_mm_throughput/AVG_LIBC_THRUPUT);
+		(avg_mm_throughput/libc_throughput);
 	}
 	
 	perfindex = (p1 + p2)*100.0;
@@ -396,9 +657,10 @@ static int add_range(range_t **ranges, char *lo, int size,
         return 0;
     }
 
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
-	(hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
+    /* The payload must lie within the extent of the heap, if in memlib */
+    if (engine->init != NULL &&
+	((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
+	 (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi()))) {
 	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
 		lo, hi, mem_heap_lo(), mem_heap_hi());
 	malloc_error(tracenum, opnum, msg);
@@ -572,6 +834,61 @@ void free_trace(trace_t *trace)
  * and throughput of the libc and mm malloc packages.
  **********************************************************************/
 
+/*
+ * eval_mm - Evaluate the engine under test on each trace using the
+ *     K-best scheme: check it for correctness, and if it is correct,
+ *     measure its utilization and throughput, filling in stats[]
+ */
+static void eval_mm(char **tracefiles, int num_tracefiles, stats_t *stats)
+{
+    trace_t *trace;
+    range_t *ranges = NULL;
+    speed_t speed_params;
+    int i;
+
+    /* A loaded engine's utilization is measured before it is used */
+    if (engine->init == NULL) {
+	for (i=0; i < num_tracefiles; i++) {
+	    trace = read_trace(tracedir, tracefiles[i]);
+	    stats[i].util = eval_rss_util(trace, i, &ranges);
+	    stats[i].ifrag = util_ifrag;
+	    free_trace(trace);
+	}
+    }
+
+    for (i=0; i < num_tracefiles; i++) {
+	trace = read_trace(tracedir, tracefiles[i]);
+	stats[i].ops = trace->num_ops;
+	if (verbose > 1)
+	    printf("Checking mm_malloc for correctness, ");
+	stats[i].valid = eval_mm_valid(trace, i, &ranges);
+	if (stats[i].valid) {
+	    if (verbose > 1)
+		printf("efficiency, ");
+	    if (engine->init != NULL) {
+		timeline_trace = tracefiles[i];
+		stats[i].util = eval_mm_util(trace, i, &ranges);
+		stats[i].ifrag = util_ifrag;
+		stats[i].sbrks = mem_sbrk_calls();
+		stats[i].min_util = timeline_min;
+		stats[i].min_util_op = timeline_min_op;
+	    }
+	    speed_params.trace = trace;
+	    speed_params.ranges = ranges;
+	    if (verbose > 1)
+		printf("and performance.\n");
+	    stats[i].secs = fsecs_stats(eval_mm_speed, &speed_params,
+					&stats[i].tstats);
+	    if (verbose)
+		eval_mm_latency(trace, &stats[i]);
+	    if (counters)
+		fsecs_counters(eval_mm_speed, &speed_params, 
+			       &stats[i].counts);
+	}
+	free_trace(trace);
+    }
+}
+
 /*
  * eval_mm_valid - Check the mm malloc package for correctness
  */
@@ -585,12 +902,11 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
     char *oldp;
     char *p;
     
-    /* Reset the heap and free any records in the range list */
-    mem_reset_brk();
+    /* Free any records in the range list */
     clear_ranges(ranges);
 
-    /* Call the mm package's init function */
-    if (mm_init() < 0) {
+    /* Reset the heap and call the mm package's init function */
+    if (engine_reset() < 0) {
 	malloc_error(tracenum, 0, "mm_init failed.");
 	return 0;
     }
@@ -605,7 +921,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
         case ALLOC: /* mm_malloc */
 
 	    /* Call the student's malloc */
-	    if ((p = mm_malloc(size)) == NULL) {
+	    if ((p = engine->malloc(size)) == NULL) {
 		malloc_error(tracenum, i, "mm_malloc failed.");
 		return 0;
 	    }
@@ -634,7 +950,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    
 	    /* Call the student's realloc */
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp, size)) == NULL) {
+	    if ((newp = engine->realloc(oldp, size)) == NULL) {
 		malloc_error(tracenum, i, "mm_realloc failed.");
 		return 0;
 	    }
@@ -654,7 +970,7 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 	    if (size < oldsize) oldsize = size;
 	    for (j = 0; j < oldsize; j++) {
-	      if (newp[j] != (index & 0xFF)) {
+	      if ((unsigned char)newp[j] != (index & 0xFF)) {
 		malloc_error(tracenum, i, "mm_realloc did not preserve the "
 			     "data from old block");
 		return 0;
@@ -672,13 +988,19 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Remove region from list and call student's free function */
 	    p = trace->blocks[index];
 	    remove_range(ranges, p);
-	    mm_free(p);
+	    engine->free(p);
 	    break;
 
 	default:
 	    app_error("Nonexistent request type in eval_mm_valid");
         }
 
+	if (heapcheck && engine->checkheap != NULL && 
+	    engine->checkheap(0) != 0) {
+	    malloc_error(tracenum, i, "mm_checkheap found the heap inconsistent.");
+	    return 0;
+	}
+
     }
 
     /* As far as we know, this is a valid malloc package */
@@ -703,6 +1025,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
     unsigned size, newsize, oldsize;
     int max_total_size = 0;
     int total_size = 0;
+    size_t usable = 0, peak_usable = 0, rss_base = 0, heapsize;
     char *p;
     char *newp, *oldp;
 
@@ -711,9 +1034,17 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
     ranges = ranges;
 
     /* initialize the heap and the mm malloc package */
-    mem_reset_brk();
-    if (mm_init() < 0)
+    if (engine_reset() < 0)
 	app_error("mm_init failed in eval_mm_util");
+    if (engine->init == NULL) {
+	/* Fault in mdriver's own arrays first so they aren't counted */
+	memset(trace->blocks, 0, trace->num_ids * sizeof(char *));
+	memset(trace->block_sizes, 0, trace->num_ids * sizeof(size_t));
+	rss_reset_peak();
+	rss_base = rss_field("VmRSS:");
+    }
+    timeline_min = 1.0;
+    timeline_min_op = 0;
 
     for (i = 0;  i < trace->num_ops;  i++) {
         switch (trace->ops[i].type) {
@@ -722,7 +1053,7 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    index = trace->ops[i].index;
 	    size = trace->ops[i].size;
 
-	    if ((p = mm_malloc(size)) == NULL) 
+	    if ((p = engine->malloc(size)) == NULL) 
 		app_error("mm_malloc failed in eval_mm_util");
 	    
 	    /* Remember region and size */
@@ -732,10 +1063,15 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Keep track of current total size
 	     * of all allocated blocks */
 	    total_size += size;
+	    usable += usable_size(p, size);
+	    if (engine->init == NULL)
+		touch(p, size);
 	    
 	    /* Update statistics */
-	    max_total_size = (total_size > max_total_size) ?
-		total_size : max_total_size;
+	    if (total_size > max_total_size) {
+		max_total_size = total_size;
+		peak_usable = usable;
+	    }
 	    break;
 
 	case REALLOC: /* mm_realloc */
@@ -744,7 +1080,8 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    oldsize = trace->block_sizes[index];
 
 	    oldp = trace->blocks[index];
-	    if ((newp = mm_realloc(oldp,newsize)) == NULL)
+	    usable -= usable_size(oldp, oldsize);
+	    if ((newp = engine->realloc(oldp,newsize)) == NULL)
 		app_error("mm_realloc failed in eval_mm_util");
 
 	    /* Remember region and size */
@@ -754,18 +1091,24 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    /* Keep track of current total size
 	     * of all allocated blocks */
 	    total_size += (newsize - oldsize);
+	    usable += usable_size(newp, newsize);
+	    if (engine->init == NULL)
+		touch(newp, newsize);
 	    
 	    /* Update statistics */
-	    max_total_size = (total_size > max_total_size) ?
-		total_size : max_total_size;
+	    if (total_size > max_total_size) {
+		max_total_size = total_size;
+		peak_usable = usable;
+	    }
 	    break;
 
         case FREE: /* mm_free */
 	    index = trace->ops[i].index;
 	    size = trace->block_sizes[index];
 	    p = trace->blocks[index];
+	    usable -= usable_size(p, size);
 	    
-	    mm_free(p);
+	    engine->free(p);
 	    
 	    /* Keep track of current total size
 	     * of all allocated blocks */
@@ -777,11 +1120,159 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
 	    app_error("Nonexistent request type in eval_mm_util");
 
         }
+
+	if (timeline != NULL && 
+	    ((i + 1) % timeline_every == 0 || i + 1 == trace->num_ops))
+	    timeline_sample(i + 1, total_size, max_total_size);
     }
 
-    return ((double)max_total_size / (double)mem_heapsize());
+    /* How much of the payload space at the peak went unrequested */
+    util_ifrag = (peak_usable > 0) ? 
+	1.0 - (double)max_total_size / (double)peak_usable : 0.0;
+
+    /* The heap of a loaded engine is what it added to the peak RSS */
+    heapsize = (engine->init != NULL) ? mem_heapsize() : 
+	rss_field("VmHWM:") - rss_base;
+    return ((double)max_total_size / (double)MAX(heapsize, 1));
+}
+
+/*
+ * eval_rss_util - eval_mm_util for an engine loaded from a shared
+ *     object, run in a child process so that its RSS counts only this
+ *     trace.  The caller must not have used the engine yet, or memory
+ *     it kept from earlier traces would be reused without showing up
+ *     in the RSS.  Also sets util_ifrag.
+ */
+static double eval_rss_util(trace_t *trace, int tracenum, range_t **ranges)
+{
+    double res[2] = {0, 0};
+    int fds[2], status;
+    pid_t pid;
+
+    if (pipe(fds) < 0)
+	unix_error("pipe failed in eval_rss_util");
+    fflush(stdout);
+    if ((pid = fork()) < 0)
+	unix_error("fork failed in eval_rss_util");
+    if (pid == 0) {
+	close(fds[0]);
+	res[0] = eval_mm_util(trace, tracenum, ranges);
+	res[1] = util_ifrag;
+	if (write(fds[1], res, sizeof(res)) != sizeof(res))
+	    _exit(1);
+	_exit(0);
+    }
+
+    close(fds[1]);
+    if (read(fds[0], res, sizeof(res)) != sizeof(res))
+	res[0] = res[1] = 0;
+    close(fds[0]);
+    if (waitpid(pid, &status, 0) < 0)
+	unix_error("waitpid failed in eval_rss_util");
+    util_ifrag = res[1];
+    return res[0];
+}
+
+/*
+ * engine_reset - Reset the heap and initialize the engine under test.
+ *     An engine loaded from a shared object has neither.  Returns what
+ *     the engine's init returned.
+ */
+static int engine_reset(void)
+{
+    if (engine->init == NULL)
+	return 0;
+    mem_reset_brk();
+    return engine->init();
+}
+
+/*
+ * usable_size - The usable size of the block p of size bytes, or size
+ *     if the engine can't tell
+ */
+static size_t usable_size(void *p, size_t size)
+{
+    return (engine->usable_size != NULL) ? engine->usable_size(p) : size;
+}
+
+/*
+ * touch - Write to every page of the block p of size bytes, so that
+ *     they count in the RSS
+ */
+static void touch(char *p, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i += mem_pagesize())
+	p[i] = 0;
+    p[size - 1] = 0;
+}
+
+/*
+ * rss_reset_peak - Reset the peak RSS of this process ("VmHWM:") to
+ *     its current RSS
+ */
+static void rss_reset_peak(void)
+{
+    int fd;
+
+    if ((fd = open("/proc/self/clear_refs", O_WRONLY)) < 0 || 
+	write(fd, "5", 1) != 1)
+	unix_error("Can't reset the peak RSS through /proc/self/clear_refs");
+    close(fd);
 }
 
+/*
+ * rss_field - Return the field ("VmRSS:" or "VmHWM:") of
+ *     /proc/self/status in bytes, or 0 if it can't be read
+ */
+static size_t rss_field(const char *field)
+{
+    char line[MAXLINE];
+    size_t kb = 0;
+    FILE *fp;
+
+    if ((fp = fopen("/proc/self/status", "r")) == NULL)
+	return 0;
+    while (fgets(line, MAXLINE, fp) != NULL)
+	if (strncmp(line, field, strlen(field)) == 0) {
+	    sscanf(line + strlen(field), "%zu", &kb);
+	    break;
+	}
+    fclose(fp);
+    return kb * 1024;
+}
+
+
+/*
+ * timeline_sample - Append one row to the utilization timeline after
+ *     opnum requests of the current trace, with total_size payload
+ *     bytes live: the payload against the heap size, and the free
+ *     space by size class as reported by mm_stats.  Also tracks the
+ *     lowest live/heap ratio seen while the payload was at least half
+ *     of its high water mark max_total_size (so that the frees at the
+ *     end of a balanced trace don't count as a collapse).
+ */
+static void timeline_sample(int opnum, int total_size, int max_total_size)
+{
+    struct mm_stats st;
+    double util;
+    int i;
+
+    engine->stats(&st);
+    util = (double)total_size / (double)st.heap_size;
+    if (util < timeline_min && 2 * total_size >= max_total_size) {
+	timeline_min = util;
+	timeline_min_op = opnum;
+    }
+    fprintf(timeline, "%s,%d,%d,%zu,%zu,%.4f,%zu,%zu,%zu,%zu,%.4f",
+	    timeline_trace, opnum, total_size, st.heap_size, 
+	    st.peak_heap_size, util, st.alloc_blocks, st.free_bytes,
+	    st.free_blocks, st.largest_free, st.ext_frag);
+    for (i = 0; i < MM_NBINS; i++)
+	fprintf(timeline, ",%zu", st.bin_free_bytes[i]);
+    fprintf(timeline, "\n");
+}
 
 /*
  * eval_mm_speed - This is the function that is used by fcyc()
@@ -794,8 +1285,7 @@ static void eval_mm_speed(void *ptr)
     trace_t *trace = ((speed_t *)ptr)->trace;
 
     /* Reset the heap and initialize the mm package */
-    mem_reset_brk();
-    if (mm_init() < 0) 
+    if (engine_reset() < 0) 
 	app_error("mm_init failed in eval_mm_speed");
 
     /* Interpret each trace request */
@@ -805,7 +1295,7 @@ static void eval_mm_speed(void *ptr)
         case ALLOC: /* mm_malloc */
             index = trace->ops[i].index;
             size = trace->ops[i].size;
-            if ((p = mm_malloc(size)) == NULL)
+            if ((p = engine->malloc(size)) == NULL)
 		app_error("mm_malloc error in eval_mm_speed");
             trace->blocks[index] = p;
             break;
@@ -814,7 +1304,7 @@ static void eval_mm_speed(void *ptr)
 	    index = trace->ops[i].index;
             newsize = trace->ops[i].size;
 	    oldp = trace->blocks[index];
-            if ((newp = mm_realloc(oldp,newsize)) == NULL)
+            if ((newp = engine->realloc(oldp,newsize)) == NULL)
 		app_error("mm_realloc error in eval_mm_speed");
             trace->blocks[index] = newp;
             break;
@@ -822,7 +1312,7 @@ static void eval_mm_speed(void *ptr)
         case FREE: /* mm_free */
             index = trace->ops[i].index;
             block = trace->blocks[index];
-            mm_free(block);
+            engine->free(block);
             break;
 
 	default:
@@ -830,6 +1320,84 @@ static void eval_mm_speed(void *ptr)
         }
 }
 
+/*
+ * cmp_double - qsort comparator for doubles
+ */
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * elapsed_ns - Nanoseconds from t0 to t1
+ */
+static double elapsed_ns(struct timespec *t0, struct timespec *t1)
+{
+    return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+/*
+ * eval_mm_latency - Time each request of the trace on its own, over
+ *     LATENCY_RUNS runs, and record the slowest request and the 99.9th
+ *     percentile in stats.  A request's time is its fastest over the
+ *     runs, less the cost of reading the clock, so an interrupt or a
+ *     page fault that hits it in only some runs doesn't count.
+ */
+static void eval_mm_latency(trace_t *trace, stats_t *stats)
+{
+    unsigned i, index, n = trace->num_ops;
+    int run;
+    double *best, ns, clock_ns = DBL_MAX;
+    struct timespec t0, t1;
+    char *p;
+
+    if (n == 0 || (best = malloc(n * sizeof(double))) == NULL)
+	return;
+    for (i = 0; i < 1000; i++) {
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	if ((ns = elapsed_ns(&t0, &t1)) < clock_ns)
+	    clock_ns = ns;
+    }
+
+    for (run = 0; run < LATENCY_RUNS; run++) {
+	if (engine_reset() < 0) 
+	    app_error("mm_init failed in eval_mm_latency");
+	for (i = 0; i < n; i++) {
+	    index = trace->ops[i].index;
+	    clock_gettime(CLOCK_MONOTONIC, &t0);
+	    switch (trace->ops[i].type) {
+	    case ALLOC:
+		p = engine->malloc(trace->ops[i].size);
+		break;
+	    case REALLOC:
+		p = engine->realloc(trace->blocks[index], trace->ops[i].size);
+		break;
+	    default:
+		engine->free(trace->blocks[index]);
+		p = NULL;
+		break;
+	    }
+	    clock_gettime(CLOCK_MONOTONIC, &t1);
+	    if (trace->ops[i].type != FREE) {
+		if (p == NULL)
+		    app_error("mm_malloc error in eval_mm_latency");
+		trace->blocks[index] = p;
+	    }
+	    ns = elapsed_ns(&t0, &t1) - clock_ns;
+	    if (run == 0 || ns < best[i])
+		best[i] = ns;
+	}
+    }
+
+    qsort(best, n, sizeof(double), cmp_double);
+    stats->max_ns = MAX(best[n - 1], 0);
+    stats->p999_ns = MAX(best[(size_t)((n - 1) * 0.999)], 0);
+    free(best);
+}
+
 /*
  * eval_libc_valid - We run this function to make sure that the
  *    libc malloc can run to completion on the set of traces.
@@ -925,58 +1493,855 @@ static void eval_libc_speed(void *ptr)
  */
 static void printresults(int n, stats_t *stats) 
 {
-    int i;
+    int i, j;
     double secs = 0;
     double ops = 0;
-    double util = 0;
+    double util = 0, ifrag = 0;
+    double events[FTIMER_NCOUNTERS] = {0};
+    double event_ops[FTIMER_NCOUNTERS] = {0}; /* ops of traces counted */
+    int have[FTIMER_NCOUNTERS] = {0};
+    double max_ns = 0, p999_ns = 0;
+    size_t sbrks = 0;
+    int latency = 0, frag = 0;
 
     /* Print the individual results for each trace */
     /* All the space before the last number on each line is added by 
      * Zheng Cai, for better formatting */
-    printf("%5s%7s %5s%8s%10s %6s\n", 
-	   "trace", " valid", "util", "ops", "secs", "Kops");
+    for (i=0; i < n; i++) {
+	latency |= stats[i].valid && stats[i].max_ns > 0;
+	frag |= stats[i].valid && stats[i].util > 0;
+    }
+    printf("%5s%7s %5s", "trace", " valid", "util");
+    if (frag)
+	printf(" %5s %5s", "ifrag", "sbrk");
+    printf("%8s%10s %6s", "ops", "secs", "Kops");
+    if (latency)
+	printf(" %8s %8s", "max ns", "p99.9 ns");
+    if (counters) {
+	for (i=0; i < n; i++)
+	    for (j=0; j < FTIMER_NCOUNTERS; j++)
+		have[j] |= stats[i].valid && stats[i].counts.valid[j];
+	for (j=0; j < FTIMER_NCOUNTERS; j++)
+	    if (have[j])
+		printf(" %9s", ftimer_counter_names[j]);
+	printf("   (per op)");
+    }
+    printf("\n");
     for (i=0; i < n; i++) {
 	if (stats[i].valid) {
-	    printf("%2d%10s%5.0f%%%8.0f%10.6f %6.0f\n", 
-		   i,
-		   "yes",
-		   stats[i].util*100.0,
+	    printf("%2d%10s%5.0f%%", i, "yes", stats[i].util*100.0);
+	    if (frag)
+		printf(" %4.0f%% %5zu", stats[i].ifrag*100.0, stats[i].sbrks);
+	    printf("%8.0f%10.6f %6.0f", 
 		   stats[i].ops,
 		   stats[i].secs,
 		   (stats[i].ops/1e3)/stats[i].secs);
+	    if (latency)
+		printf(" %8.0f %8.0f", stats[i].max_ns, stats[i].p999_ns);
+	    for (j=0; j < FTIMER_NCOUNTERS; j++) {
+		if (!have[j])
+		    continue;
+		if (stats[i].counts.valid[j]) {
+		    printf(" %9.2f", stats[i].counts.val[j] / stats[i].ops);
+		    events[j] += stats[i].counts.val[j];
+		    event_ops[j] += stats[i].ops;
+		}
+		else
+		    printf(" %9s", "-");
+	    }
+	    printf("\n");
 	    secs += stats[i].secs;
 	    ops += stats[i].ops;
 	    util += stats[i].util;
+	    ifrag += stats[i].ifrag;
+	    sbrks += stats[i].sbrks;
+	    max_ns = MAX(max_ns, stats[i].max_ns);
+	    p999_ns = MAX(p999_ns, stats[i].p999_ns);
 	}
 	else {
-	    printf("%2d%10s%6s%8s%10s %6s\n", 
-		   i,
-		   "no",
-		   "-",
-		   "-",
-		   "-",
-		   "-");
+	    printf("%2d%10s%6s", i, "no", "-");
+	    if (frag)
+		printf(" %5s %5s", "-", "-");
+	    printf("%8s%10s %6s\n", "-", "-", "-");
 	}
     }
 
     /* Print the aggregate results for the set of traces */
     if (errors == 0) {
-	printf("%12s%5.0f%%%8.0f%10.6f %6.0f\n", 
-	       "Total       ",
-	       (util/n)*100.0,
+	printf("%12s%5.0f%%", "Total       ", (util/n)*100.0);
+	if (frag)
+	    printf(" %4.0f%% %5zu", (ifrag/n)*100.0, sbrks);
+	printf("%8.0f%10.6f %6.0f", 
 	       ops, 
 	       secs,
 	       (ops/1e3)/secs);
+	if (latency)
+	    printf(" %8.0f %8.0f", max_ns, p999_ns);
+	for (j=0; j < FTIMER_NCOUNTERS; j++)
+	    if (have[j])
+		printf(" %9.2f", events[j] / event_ops[j]);
+	printf("\n");
+    }
+    else {
+	printf("%12s%6s", "Total       ", "-");
+	if (frag)
+	    printf(" %5s %5s", "-", "-");
+	printf("%8s%10s %6s\n", "-", "-", "-");
+    }
+
+}
+
+/*
+ * printengines - Print the utilization, internal fragmentation and
+ *     throughput of each engine on each trace, side by side
+ */
+static void printengines(int n, int nengines, const mm_engine_t **engines,
+			 stats_t **stats)
+{
+    double util, ifrag, ops, secs;
+    int i, k, valid;
+
+    printf("\n%5s", "");
+    for (k = 0; k < nengines; k++)
+	printf("%22s", engines[k]->name);
+    printf("\n%5s", "trace");
+    for (k = 0; k < nengines; k++)
+	printf("%7s%6s%9s", "util", "ifrag", "Kops");
+    printf("\n");
+    for (i = 0; i < n; i++) {
+	printf("%5d", i);
+	for (k = 0; k < nengines; k++) {
+	    if (stats[k][i].valid)
+		printf("%6.0f%%%5.0f%%%9.0f", stats[k][i].util*100.0,
+		       stats[k][i].ifrag*100.0,
+		       (stats[k][i].ops/1e3)/stats[k][i].secs);
+	    else
+		printf("%7s%6s%9s", "-", "-", "-");
+	}
+	printf("\n");
+    }
+
+    /* An engine's totals need every trace to have passed */
+    printf("%5s", "Total");
+    for (k = 0; k < nengines; k++) {
+	util = ifrag = ops = secs = 0;
+	valid = 1;
+	for (i = 0; i < n; i++) {
+	    valid &= stats[k][i].valid;
+	    util += stats[k][i].util;
+	    ifrag += stats[k][i].ifrag;
+	    ops += stats[k][i].ops;
+	    secs += stats[k][i].secs;
+	}
+	if (valid)
+	    printf("%6.0f%%%5.0f%%%9.0f", (util/n)*100.0, (ifrag/n)*100.0,
+		   (ops/1e3)/secs);
+	else
+	    printf("%7s%6s%9s", "-", "-", "-");
+    }
+    printf("\n");
+}
+
+/*
+ * printtiming - prints the sample statistics behind each timing, if the
+ *     timing package collected any
+ */
+static void printtiming(int n, stats_t *stats)
+{
+    int i;
+    fstats_t *t;
+
+    for (i=0; i < n; i++)
+	if (stats[i].valid && stats[i].tstats.runs > 0)
+	    break;
+    if (i == n)
+	return;
+
+    printf("%5s%6s%6s%12s%8s%16s\n",
+	   "trace", "runs", "outl", "median", "MAD", "95% CI");
+    for (i=0; i < n; i++) {
+	t = &stats[i].tstats;
+	if (!stats[i].valid || t->runs == 0)
+	    continue;
+	printf("%2d%9d%6d%12.4g%7.1f%%",
+	       i,
+	       t->runs,
+	       t->outliers,
+	       t->median,
+	       100.0 * t->mad / t->median);
+	if (t->ci)
+	    printf("%8.1f%%/+%.1f%%\n",
+		   100.0 * (t->ci_lo - t->median) / t->median,
+		   100.0 * (t->ci_hi - t->median) / t->median);
+	else
+	    printf("%16s\n", "none");
+    }
+}
+
+/*
+ * printtimeline - Summarize the utilization timeline: for each trace,
+ *     the request after which live payload was the smallest fraction
+ *     of the heap (see timeline_sample)
+ */
+static void printtimeline(int n, char **tracefiles, stats_t *stats,
+			  char *file)
+{
+    int i;
+
+    printf("Utilization timeline (every %d requests) written to %s\n",
+	   timeline_every, file);
+    printf("%-30s%10s%10s%10s\n", "trace", "final", "lowest", "at op");
+    for (i=0; i < n; i++) {
+	if (!stats[i].valid)
+	    continue;
+	if (stats[i].min_util_op == 0) /* no sample qualified */
+	    printf("%-30.30s%9.0f%%%10s%10s\n", tracefiles[i], 
+		   stats[i].util*100.0, "-", "-");
+	else
+	    printf("%-30.30s%9.0f%%%9.0f%%%10d\n", tracefiles[i], 
+		   stats[i].util*100.0, stats[i].min_util*100.0, 
+		   stats[i].min_util_op);
+    }
+}
+
+/*
+ * run_raw - Run the mdriver binary prog with -R over the trace set and 
+ *     return its aggregate throughput in ops/sec
+ */
+static double run_raw(char *prog, char **tracefiles, int num_tracefiles)
+{
+    char *args[2*MAXLINE];
+    char line[MAXLINE];
+    int fds[2];
+    int i, nargs, status, tracenum;
+    double ops, secs, total_ops = 0, total_secs = 0;
+    pid_t pid;
+    FILE *fp;
+
+    /* Rebuild the trace selection for the child */
+    nargs = 0;
+    args[nargs++] = prog;
+    args[nargs++] = "-a";
+    args[nargs++] = "-R";
+    if (tracefiles != default_tracefiles) {
+	for (i = 0; i < num_tracefiles && nargs < 2*MAXLINE - 3; i++) {
+	    args[nargs++] = "-f";
+	    args[nargs++] = tracefiles[i];
+	}
+    }
+    else {
+	args[nargs++] = "-t";
+	args[nargs++] = tracedir;
+    }
+    args[nargs] = NULL;
+
+    if (pipe(fds) < 0)
+	unix_error("pipe failed in run_raw");
+    fflush(stdout);
+    if ((pid = fork()) < 0)
+	unix_error("fork failed in run_raw");
+    if (pid == 0) {
+	close(fds[0]);
+	dup2(fds[1], STDOUT_FILENO);
+	close(fds[1]);
+	execvp(prog, args);
+	fprintf(stderr, "Could not run %s: %s\n", prog, strerror(errno));
+	exit(1);
+    }
+
+    close(fds[1]);
+    if ((fp = fdopen(fds[0], "r")) == NULL)
+	unix_error("fdopen failed in run_raw");
+    while (fgets(line, MAXLINE, fp) != NULL) {
+	if (sscanf(line, "raw %d %lf %lf", &tracenum, &ops, &secs) == 3) {
+	    total_ops += ops;
+	    total_secs += secs;
+	}
+    }
+    fclose(fp);
+    if (waitpid(pid, &status, 0) < 0)
+	unix_error("waitpid failed in run_raw");
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || total_secs == 0) {
+	sprintf(msg, "%s did not complete the trace set", prog);
+	app_error(msg);
+    }
+    return total_ops / total_secs;
+}
+
+/*
+ * ab_compare - Alternate runs of this build (A) and another build (B)
+ *     over the trace set for AB_ROUNDS rounds, in ABBA order so that
+ *     slow drift in machine state affects both equally, and report
+ *     whether their throughputs differ significantly.
+ */
+static void ab_compare(char *self, char *other, char **tracefiles, 
+		       int num_tracefiles)
+{
+    double a[AB_ROUNDS], b[AB_ROUNDS];
+    fstats_t sa, sb;
+    double p, change;
+    int i;
+
+    printf("A/B comparison over %d rounds\n", AB_ROUNDS);
+    printf("  A = %s\n  B = %s\n", self, other);
+    for (i = 0; i < AB_ROUNDS; i++) {
+	if (i % 2 == 0) {
+	    a[i] = run_raw(self, tracefiles, num_tracefiles);
+	    b[i] = run_raw(other, tracefiles, num_tracefiles);
+	}
+	else {
+	    b[i] = run_raw(other, tracefiles, num_tracefiles);
+	    a[i] = run_raw(self, tracefiles, num_tracefiles);
+	}
+	if (verbose)
+	    printf("round %2d: A %8.0f Kops  B %8.0f Kops\n", 
+		   i, a[i]/1e3, b[i]/1e3);
+    }
+
+    p = fstats_mannwhitney(a, AB_ROUNDS, b, AB_ROUNDS);
+    fstats_summarize(a, AB_ROUNDS, &sa);
+    fstats_summarize(b, AB_ROUNDS, &sb);
+
+    printf("%5s%12s%8s%22s\n", "build", "median Kops", "MAD", "95% CI (Kops)");
+    printf("%5s%12.0f%7.1f%%", "A", sa.median/1e3, 100.0 * sa.mad / sa.median);
+    if (sa.ci)
+	printf("%11.0f ..%8.0f\n", sa.ci_lo/1e3, sa.ci_hi/1e3);
+    else
+	printf("%22s\n", "none");
+    printf("%5s%12.0f%7.1f%%", "B", sb.median/1e3, 100.0 * sb.mad / sb.median);
+    if (sb.ci)
+	printf("%11.0f ..%8.0f\n", sb.ci_lo/1e3, sb.ci_hi/1e3);
+    else
+	printf("%22s\n", "none");
+
+    change = 100.0 * (sa.median - sb.median) / sb.median;
+    printf("A vs B throughput: %+.1f%% (Mann-Whitney p = %.3g): %s\n",
+	   change, p, (p < 0.05) ? "significant at the 5% level" 
+	   : "not significant at the 5% level");
+}
+
+/*
+ * tune_params - The parameters at the given levels.  Level 0 of each
+ *     is the smallest: chunks of 4 KB to 256 KB, split thresholds of 2
+ *     to 16 doublewords, and a quarter to all of the bins above the
+ *     exact small bins.  The other parameters keep their current values.
+ */
+static void tune_params(const int *level, struct mm_params *p)
+{
+    mm_get_params(p);
+    p->chunksize = (size_t)1 << (12 + 2 * level[0]);
+    p->split_min = 2 * MM_DSIZE << level[1];
+    p->nbins = MM_SMALL_BINS + 
+	(MM_NBINS - MM_SMALL_BINS) * (level[2] + 1) / TUNE_LEVELS;
+}
+
+/*
+ * tune_eval - Run mm with the parameters of t over the traces and fill
+ *     in its utilization, throughput and score.  The score weighs them
+ *     like the performance index, but with throughput relative to base
+ *     Kops (the defaults' throughput) and without the cap, so that a
+ *     faster configuration always scores higher.
+ */
+static void tune_eval(tune_t *t, char **tracefiles, int num_tracefiles,
+		      stats_t *stats, double base)
+{
+    double ops = 0, secs = 0, util = 0;
+    int i;
+
+    if (mm_set_params(&t->params) < 0)
+	app_error("autotuner made invalid parameters");
+    memset(stats, 0, num_tracefiles * sizeof(stats_t));
+    eval_mm(tracefiles, num_tracefiles, stats);
+    t->valid = 1;
+    for (i = 0; i < num_tracefiles; i++) {
+	t->valid &= stats[i].valid;
+	ops += stats[i].ops;
+	secs += stats[i].secs;
+	util += stats[i].util;
+    }
+    t->util = util / num_tracefiles;
+    t->kops = t->valid ? (ops / 1e3) / secs : 0;
+    t->score = UTIL_WEIGHT * t->util + 
+	(1.0 - UTIL_WEIGHT) * (base > 0 ? t->kops / base : 1.0);
+    if (!t->valid)
+	t->score = 0;
+    printf("  chunksize=%-7zu split_min=%-4zu nbins=%-3d %6.1f%% %9.0f %7.3f%s\n",
+	   t->params.chunksize, t->params.split_min, t->params.nbins,
+	   t->util * 100.0, t->kops, t->score, t->valid ? "" : "  (failed)");
+}
+
+/*
+ * tune_find - Return the configuration at the given levels, evaluating
+ *     it and adding it to tried[] if it is new, or NULL if it is new and
+ *     the budget of *ntried configurations is used up
+ */
+static tune_t *tune_find(const int *level, tune_t *tried, int *ntried,
+			 int budget, char **tracefiles, int num_tracefiles,
+			 stats_t *stats, double base)
+{
+    tune_t *t;
+    int i;
+
+    for (i = 0; i < *ntried; i++)
+	if (memcmp(tried[i].level, level, sizeof(tried[i].level)) == 0)
+	    return &tried[i];
+    if (*ntried >= budget)
+	return NULL;
+    t = &tried[(*ntried)++];
+    memcpy(t->level, level, sizeof(t->level));
+    tune_params(level, &t->params);
+    tune_eval(t, tracefiles, num_tracefiles, stats, base);
+    return t;
+}
+
+/*
+ * autotune - Search mm.c's run-time parameters for the best tradeoffs
+ *     between utilization and throughput on the traces, print the
+ *     configurations tried with the Pareto front marked, and write
+ *     the front to outfile as a config for MM_PARAMS (libmm.so) or -P.
+ *     The search is "grid" (every combination of levels), "random"
+ *     (TUNE_BUDGET random combinations), or "hill" (from the defaults'
+ *     levels, move to the best-scoring neighbor, one level up or down
+ *     in one parameter, while that improves the score); random and
+ *     hill may be followed by ":<budget>".
+ */
+static void autotune(char *search, char **tracefiles, int num_tracefiles,
+		     char *outfile)
+{
+    int ncombos = TUNE_LEVELS * TUNE_LEVELS * TUNE_LEVELS;
+    int budget = TUNE_BUDGET, ntried = 0, i, k, j, dominated;
+    int level[3], next[3];
+    unsigned seed = 1;
+    tune_t base, *tried, *t, *best, *cur;
+    stats_t *stats;
+    char *colon;
+    FILE *fp;
+
+    if ((colon = strchr(search, ':')) != NULL) {
+	*colon = '\0';
+	if ((budget = atoi(colon + 1)) <= 0) {
+	    usage();
+	    exit(1);
+	}
+    }
+    if (strcmp(search, "grid") == 0)
+	budget = ncombos;
+    else if (strcmp(search, "random") != 0 && strcmp(search, "hill") != 0) {
+	fprintf(stderr, "Unknown search %s\n", search);
+	usage();
+	exit(1);
+    }
+    if (budget > ncombos)
+	budget = ncombos;
+    tried = (tune_t *)calloc(ncombos, sizeof(tune_t));
+    stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
+    if (tried == NULL || stats == NULL)
+	unix_error("calloc failed in autotune");
+    engine = &mm_engine;
+
+    /* The defaults set the throughput that scores are relative to */
+    printf("Autotuning mm.c (%s search) over %d traces\n", search,
+	   num_tracefiles);
+    printf("  %-42s %7s %9s %7s\n", "defaults", "util", "Kops", "score");
+    mm_get_params(&base.params);
+    tune_eval(&base, tracefiles, num_tracefiles, stats, 0);
+    if (!base.valid)
+	app_error("mm fails the traces with its default parameters");
+    base.score = UTIL_WEIGHT * base.util + (1.0 - UTIL_WEIGHT);
+
+    /* If the defaults are on the grid, they count as tried */
+    for (i = 0; i < ncombos; i++) {
+	level[0] = i / (TUNE_LEVELS * TUNE_LEVELS);
+	level[1] = i / TUNE_LEVELS % TUNE_LEVELS;
+	level[2] = i % TUNE_LEVELS;
+	tune_params(level, &tried[0].params);
+	if (memcmp(&tried[0].params, &base.params, sizeof(base.params)) == 0) {
+	    tried[0] = base;
+	    memcpy(tried[0].level, level, sizeof(level));
+	    ntried = 1;
+	    break;
+	}
+    }
+    printf("  tried\n");
+
+    if (strcmp(search, "grid") == 0) {
+	for (i = 0; i < ncombos; i++) {
+	    level[0] = i / (TUNE_LEVELS * TUNE_LEVELS);
+	    level[1] = i / TUNE_LEVELS % TUNE_LEVELS;
+	    level[2] = i % TUNE_LEVELS;
+	    tune_find(level, tried, &ntried, budget, tracefiles,
+		      num_tracefiles, stats, base.kops);
+	}
+    }
+    else if (strcmp(search, "random") == 0) {
+	/* A fixed seed, so that a rerun tries the same configurations */
+	while (ntried < budget) {
+	    for (k = 0; k < 3; k++)
+		level[k] = rand_r(&seed) % TUNE_LEVELS;
+	    tune_find(level, tried, &ntried, budget, tracefiles,
+		      num_tracefiles, stats, base.kops);
+	}
     }
     else {
-	printf("%12s%6s%8s%10s %6s\n", 
-	       "Total       ",
-	       "-", 
-	       "-", 
-	       "-", 
-	       "-");
+	/* Start at the levels closest to the defaults */
+	for (level[0] = 0; level[0] < TUNE_LEVELS - 1 &&
+		 ((size_t)1 << (12 + 2 * level[0])) < base.params.chunksize;
+	     level[0]++)
+	    ;
+	for (level[1] = 0; level[1] < TUNE_LEVELS - 1 &&
+		 (2 * MM_DSIZE << level[1]) < base.params.split_min; level[1]++)
+	    ;
+	level[2] = TUNE_LEVELS - 1;
+	cur = tune_find(level, tried, &ntried, budget, tracefiles,
+			num_tracefiles, stats, base.kops);
+	while (cur != NULL) {
+	    best = cur;
+	    for (k = 0; k < 3; k++)
+		for (j = -1; j <= 1; j += 2) {
+		    memcpy(next, cur->level, sizeof(next));
+		    next[k] += j;
+		    if (next[k] < 0 || next[k] >= TUNE_LEVELS)
+			continue;
+		    t = tune_find(next, tried, &ntried, budget, tracefiles,
+				  num_tracefiles, stats, base.kops);
+		    if (t != NULL && t->score > best->score)
+			best = t;
+		}
+	    if (best == cur)
+		break;
+	    cur = best;
+	}
+    }
+
+    /* A configuration is on the front unless another beats it in both */
+    best = NULL;
+    printf("\nPareto front (utilization vs. throughput):\n");
+    if ((fp = fopen(outfile, "w")) == NULL)
+	unix_error("ERROR: could not open autotuner output file");
+    fprintf(fp, "# mm.c parameters from \"mdriver -u %s\" over %d traces;\n"
+	    "# use with MM_PARAMS=\"$(grep -v '^#' %s)\" LD_PRELOAD=./libmm.so\n"
+	    "# or mdriver -P.  The Pareto front of utilization and throughput:\n",
+	    search, num_tracefiles, outfile);
+    for (i = 0; i < ntried; i++) {
+	if (!tried[i].valid)
+	    continue;
+	for (dominated = 0, k = 0; k < ntried && !dominated; k++)
+	    dominated = tried[k].valid && 
+		tried[k].util >= tried[i].util && 
+		tried[k].kops >= tried[i].kops &&
+		(tried[k].util > tried[i].util || tried[k].kops > tried[i].kops);
+	if (dominated)
+	    continue;
+	printf("  chunksize=%-7zu split_min=%-4zu nbins=%-3d %6.1f%% %9.0f %7.3f\n",
+	       tried[i].params.chunksize, tried[i].params.split_min, 
+	       tried[i].params.nbins, tried[i].util * 100.0, tried[i].kops,
+	       tried[i].score);
+	fprintf(fp, "#   chunksize=%zu,split_min=%zu,nbins=%d"
+		"  util %.1f%%  %.0f Kops\n",
+		tried[i].params.chunksize, tried[i].params.split_min, 
+		tried[i].params.nbins, tried[i].util * 100.0, tried[i].kops);
+	if (best == NULL || tried[i].score > best->score)
+	    best = &tried[i];
+    }
+
+    /* Deploy the best-scoring point on the front */
+    if (best == NULL || best->score <= base.score)
+	best = &base;
+    fprintf(fp, "# Best score (%.0f%% utilization, %.0f%% throughput "
+	    "relative to the defaults):\n", UTIL_WEIGHT * 100.0,
+	    (1.0 - UTIL_WEIGHT) * 100.0);
+    fprintf(fp, "chunksize=%zu,split_min=%zu,nbins=%d,place_high=%zu\n",
+	    best->params.chunksize, best->params.split_min, best->params.nbins,
+	    best->params.place_high);
+    if (fclose(fp) != 0)
+	unix_error("ERROR: could not write autotuner output file");
+    printf("Best score: chunksize=%zu,split_min=%zu,nbins=%d "
+	   "(%+.1f%% util, %+.1f%% Kops over the defaults), written to %s\n",
+	   best->params.chunksize, best->params.split_min, best->params.nbins,
+	   (best->util - base.util) * 100.0,
+	   100.0 * (best->kops - base.kops) / base.kops, outfile);
+    free(tried);
+    free(stats);
+}
+
+/* Shared by the cache benchmark threads */
+static pthread_barrier_t bench_start, bench_done, bench_exit;
+
+/*
+ * cache_bench_thread - Make CACHE_BENCH_OPS random small requests
+ *     through mmcache, free everything, then stay alive (idle, with
+ *     whatever it has cached) until the main thread has looked
+ */
+static void *cache_bench_thread(void *arg)
+{
+    char *live[CACHE_BENCH_LIVE] = {NULL};
+    unsigned seed = (unsigned)(uintptr_t)arg * 2654435761u + 1;
+    int i, k, size;
+
+    pthread_barrier_wait(&bench_start);
+    for (i = 0; i < CACHE_BENCH_OPS; i++) {
+	k = rand_r(&seed) % CACHE_BENCH_LIVE;
+	if (live[k] != NULL) {
+	    mmcache_free(live[k]);
+	    live[k] = NULL;
+	    continue;
+	}
+	size = CACHE_BENCH_MIN + 
+	    rand_r(&seed) % (CACHE_BENCH_MAX - CACHE_BENCH_MIN + 1);
+	if ((live[k] = mmcache_malloc(size)) == NULL)
+	    app_error("mmcache_malloc failed in cache_bench");
+	live[k][0] = live[k][size-1] = (char)k;
+    }
+    for (k = 0; k < CACHE_BENCH_LIVE; k++)
+	mmcache_free(live[k]);
+    pthread_barrier_wait(&bench_done);
+    pthread_barrier_wait(&bench_exit);
+    return NULL;
+}
+
+/*
+ * cache_bench - Run nthreads threads through each mmcache mode on a
+ *     fresh heap and report throughput, the bytes left in the caches
+ *     while the threads sit idle, and the heap size
+ */
+static void cache_bench(int nthreads)
+{
+    pthread_t *tids;
+    struct timespec t0, t1;
+    double secs;
+    size_t cached;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int mode, used, i;
+
+    if ((tids = malloc(nthreads * sizeof(pthread_t))) == NULL)
+	unix_error("malloc failed in cache_bench");
+    printf("Cache benchmark: %d threads on %ld CPUs, %d requests each\n",
+	   nthreads, ncpu, CACHE_BENCH_OPS);
+    printf("%7s%12s%14s%12s\n", "cache", "Mops/sec", "cached KB", "heap KB");
+    for (mode = MMCACHE_NONE; mode <= MMCACHE_CPU; mode++) {
+	mem_reset_brk();
+	if (mm_init() < 0)
+	    app_error("mm_init failed in cache_bench");
+	if ((used = mmcache_init(mode)) != mode) {
+	    printf("%7s%12s  (rseq unavailable)\n", mmcache_names[mode], "-");
+	    continue;
+	}
+	pthread_barrier_init(&bench_start, NULL, nthreads + 1);
+	pthread_barrier_init(&bench_done, NULL, nthreads + 1);
+	pthread_barrier_init(&bench_exit, NULL, nthreads + 1);
+	for (i = 0; i < nthreads; i++)
+	    if (pthread_create(&tids[i], NULL, cache_bench_thread, 
+			       (void *)(uintptr_t)i) != 0)
+		unix_error("pthread_create failed in cache_bench");
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	pthread_barrier_wait(&bench_start);
+	pthread_barrier_wait(&bench_done);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	cached = mmcache_cached_bytes();
+	pthread_barrier_wait(&bench_exit);
+	for (i = 0; i < nthreads; i++)
+	    pthread_join(tids[i], NULL);
+	pthread_barrier_destroy(&bench_start);
+	pthread_barrier_destroy(&bench_done);
+	pthread_barrier_destroy(&bench_exit);
+
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	printf("%7s%12.2f%14.1f%12.1f\n", mmcache_names[used],
+	       (double)nthreads * CACHE_BENCH_OPS / secs / 1e6,
+	       cached / 1024.0, mem_heapsize() / 1024.0);
+    }
+    free(tids);
+}
+
+/*
+ * numa_walk - Follow the list at arg for NUMA_BENCH_STEPS steps and
+ *     return the time taken, in ns per step, through arg
+ */
+static void *numa_walk(void *arg)
+{
+    void **p = *(void ***)arg;
+    struct timespec t0, t1;
+    long i;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < NUMA_BENCH_STEPS; i++)
+	p = *p;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    *(double *)arg = ((t1.tv_sec - t0.tv_sec) * 1e9 + 
+		      (t1.tv_nsec - t0.tv_nsec)) / NUMA_BENCH_STEPS;
+    /* Keep the walk from being optimized away */
+    if (p == NULL)
+	printf("!");
+    return NULL;
+}
+
+/*
+ * numa_bench - For every arena, build a randomly linked list of
+ *     NUMA_BENCH_BYTES in it (mm_numa_set_node) and time a walk of the
+ *     list from the CPUs of every node.  Shows the cost of remote
+ *     memory, and also where the kernel really placed the arena's pages.
+ */
+static void numa_bench(void)
+{
+    int nodes, a, b, cpu, node, pinned;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t n = NUMA_BENCH_BYTES / 64, i, j;
+    void ***blocks, **tmp;
+    union { void **head; double ns; } arg;
+    pthread_attr_t attr;
+    pthread_t tid;
+    cpu_set_t set;
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in numa_bench");
+    nodes = mm_numa_nodes();
+    if ((blocks = malloc(n * sizeof(void **))) == NULL)
+	unix_error("malloc failed in numa_bench");
+    printf("NUMA benchmark: %d arenas, %d MB list each, %ld CPUs\n", 
+	   nodes, NUMA_BENCH_BYTES >> 20, ncpu);
+    printf("ns per access (rows: arena, columns: CPUs of node; "
+	   "* = node has no CPUs, run anywhere)\n%10s", "");
+    for (b = 0; b < nodes; b++)
+	printf("%7s%-3d", "node ", b);
+    printf("%12s\n", "pages on");
+
+    for (a = 0; a < nodes; a++) {
+	/* 48 bytes of payload make a 64-byte block */
+	mm_numa_set_node(a);
+	for (i = 0; i < n; i++)
+	    if ((blocks[i] = mm_malloc_inline(48)) == NULL)
+		app_error("mm_malloc failed in numa_bench (heap too small?)");
+	mm_numa_set_node(-1);
+	for (i = n - 1; i > 0; i--) {
+	    j = (size_t)rand() % (i + 1);
+	    tmp = blocks[i];
+	    blocks[i] = blocks[j];
+	    blocks[j] = tmp;
+	}
+	for (i = 0; i < n; i++)
+	    *blocks[i] = blocks[(i + 1) % n];
+
+	printf("arena %-4d", a);
+	for (b = 0; b < nodes; b++) {
+	    CPU_ZERO(&set);
+	    pinned = 0;
+	    for (cpu = 0; cpu < ncpu && cpu < CPU_SETSIZE; cpu++)
+		if (mem_cpu_node(cpu) == b) {
+		    CPU_SET(cpu, &set);
+		    pinned = 1;
+		}
+	    pthread_attr_init(&attr);
+	    if (pinned)
+		pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+	    arg.head = blocks[0];
+	    if (pthread_create(&tid, &attr, numa_walk, &arg) != 0)
+		unix_error("pthread_create failed in numa_bench");
+	    pthread_join(tid, NULL);
+	    pthread_attr_destroy(&attr);
+	    printf("%9.1f%c", arg.ns, pinned ? ' ' : '*');
+	}
+
+	/* Ask the kernel which node holds the list's first page */
+	if (syscall(SYS_get_mempolicy, &node, NULL, 0, blocks[0], 
+		    MPOL_F_NODE | MPOL_F_ADDR) == 0)
+	    printf("%7s%-5d\n", "node ", node);
+	else
+	    printf("%12s\n", "?");
+	for (i = 0; i < n; i++)
+	    mm_free(blocks[i]);
+    }
+    free(blocks);
+}
+
+/* A thread's counters in the false-sharing benchmark: one line's worth */
+typedef struct {
+    long n[8];
+} counters_t;
+
+/*
+ * share_bump - Bump the counters at arg SHARE_BENCH_ITERS times
+ */
+static void *share_bump(void *arg)
+{
+    volatile long *n = ((counters_t *)arg)->n;
+    long i;
+
+    pthread_barrier_wait(&bench_start);
+    for (i = 0; i < SHARE_BENCH_ITERS; i++) {
+	n[0]++;
+	n[7] += i;
     }
+    return NULL;
+}
 
+/*
+ * share_bench - For 1, 2, 4, ... maxthreads threads, allocate one
+ *     counters_t per thread back to back, with mm_malloc and with
+ *     mm_malloc_flags(MM_NOSHARE), and time the threads bumping their
+ *     own counters.  With mm_malloc neighbouring counters share cache
+ *     lines, and the lines bounce between the CPUs (false sharing).
+ */
+static void share_bench(int maxthreads)
+{
+    pthread_t *tids;
+    counters_t **ctr;
+    struct timespec t0, t1;
+    double secs[2];
+    int nthreads, flags, shared[2], i, j;
+
+    if ((tids = malloc(maxthreads * sizeof(pthread_t))) == NULL ||
+	(ctr = malloc(maxthreads * sizeof(counters_t *))) == NULL)
+	unix_error("malloc failed in share_bench");
+    printf("False-sharing benchmark: %d-byte counters, %ld CPUs\n",
+	   (int)sizeof(counters_t), sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%8s%20s%20s\n", "", "mm_malloc", "MM_NOSHARE");
+    printf("%8s%12s%8s%12s%8s\n", "threads", "Mops/sec", "shared", 
+	   "Mops/sec", "shared");
+    for (nthreads = 1; nthreads <= maxthreads; nthreads *= 2) {
+	for (flags = 0; flags <= MM_NOSHARE; flags += MM_NOSHARE) {
+	    mem_reset_brk();
+	    if (mm_init() < 0)
+		app_error("mm_init failed in share_bench");
+	    for (i = 0; i < nthreads; i++)
+		if ((ctr[i] = mm_malloc_flags(sizeof(counters_t), flags)) == NULL)
+		    app_error("mm_malloc_flags failed in share_bench");
+		else
+		    memset(ctr[i], 0, sizeof(counters_t));
+
+	    /* Counters that have a cache line in common with another */
+	    shared[flags] = 0;
+	    for (i = 0; i < nthreads; i++)
+		for (j = 0; j < nthreads; j++)
+		    if (i != j && 
+			(uintptr_t)ctr[i] / MM_LINE <= 
+			((uintptr_t)(ctr[j] + 1) - 1) / MM_LINE &&
+			(uintptr_t)ctr[j] / MM_LINE <= 
+			((uintptr_t)(ctr[i] + 1) - 1) / MM_LINE) {
+			shared[flags]++;
+			break;
+		    }
+
+	    pthread_barrier_init(&bench_start, NULL, nthreads + 1);
+	    for (i = 0; i < nthreads; i++)
+		if (pthread_create(&tids[i], NULL, share_bump, ctr[i]) != 0)
+		    unix_error("pthread_create failed in share_bench");
+	    clock_gettime(CLOCK_MONOTONIC, &t0);
+	    pthread_barrier_wait(&bench_start);
+	    for (i = 0; i < nthreads; i++)
+		pthread_join(tids[i], NULL);
+	    clock_gettime(CLOCK_MONOTONIC, &t1);
+	    pthread_barrier_destroy(&bench_start);
+	    secs[flags] = (t1.tv_sec - t0.tv_sec) + 
+		(t1.tv_nsec - t0.tv_nsec) / 1e9;
+	}
+	printf("%8d%12.1f%8d%12.1f%8d\n", nthreads,
+	       (double)nthreads * SHARE_BENCH_ITERS / secs[0] / 1e6, shared[0],
+	       (double)nthreads * SHARE_BENCH_ITERS / secs[1] / 1e6, shared[1]);
+    }
+    free(ctr);
+    free(tids);
 }
 
 /* 
@@ -1011,14 +2376,37 @@ void malloc_error(int tracenum, int opnum, char *msg)
  */
 static void usage(void) 
 {
-    fprintf(stderr, "Usage: mdriver [-hvVal] [-f <file>] [-t <dir>]\n");
+    int i;
+
+    fprintf(stderr, "Usage: mdriver [-hvVaclpR] [-f <file>] [-t <dir>] [-A <mdriver>]\n");
+    fprintf(stderr, "               [-T <n> [-o <file>]] [-b <threads>] [-N]\n");
+    fprintf(stderr, "               [-F <threads>] [-e <engine>,...] [-d <lib>]\n");
+    fprintf(stderr, "               [-P <params>] [-u <search>[:<n>] [-o <file>]]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-a         Don't check the team structure.\n");
-    fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
+    fprintf(stderr, "\t-A <prog>  Compare throughput against mdriver build <prog>.\n");
+    fprintf(stderr, "\t-b <n>     Run the cache benchmark with <n> threads instead.\n");
+    fprintf(stderr, "\t-c         Check heap consistency after every request.\n");
+    fprintf(stderr, "\t-d <lib>   Load the malloc in shared object <lib> as an engine.\n");
+    fprintf(stderr, "\t-e <list>  Compare the comma-separated engines instead:\n");
+    for (i = 0; i < mm_num_engines; i++)
+	fprintf(stderr, "\t             %-10s %s\n", mm_engines[i]->name,
+		mm_engines[i]->descr);
+    fprintf(stderr, "\t-F <n>     Run the false-sharing benchmark with up to <n> threads instead.\n");
+    fprintf(stderr, "\t-f <file>  Use <file> as the trace file (may be repeated).\n");
     fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
-    fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-l         Show the results for libc malloc as well.\n");
+    fprintf(stderr, "\t-N         Run the NUMA remote-access benchmark instead.\n");
+    fprintf(stderr, "\t-o <file>  Write the -T timeline (default timeline.csv) or the -u\n"
+	    "\t           config (default mm-params.conf) to <file>.\n");
+    fprintf(stderr, "\t-P <list>  Set mm.c's parameters, e.g. chunksize=16384,split_min=64,nbins=40.\n");
+    fprintf(stderr, "\t-p         Report hardware performance counters per op.\n");
+    fprintf(stderr, "\t-R         Print raw per-trace timings only.\n");
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-T <n>     Sample heap utilization every <n> requests (not with -e or -d).\n");
+    fprintf(stderr, "\t-u <s>     Autotune mm.c's parameters with search grid, random[:<n>]\n"
+	    "\t           or hill[:<n>] instead, trying at most <n> settings.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
 }
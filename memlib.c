@@ -2,14 +2,34 @@
  * memlib.c - a module that simulates the memory system.  Needed because it 
  *            allows us to interleave calls from the student's malloc package 
  *            with the system's malloc package in libc.
+ *
+ *            The storage is mapped directly with mmap rather than obtained
+ *            from libc malloc, so that the same module can back mm.c when
+ *            it replaces malloc itself (see mm_preload.c).  Pages are
+ *            reserved without swap and only become resident when touched,
+ *            so MAX_HEAP can be set far larger than the heap ever grows.
+ *            Because the heap is a real mapping, pages of it can also be
+ *            protected (mem_protect), which mm.c's guard page mode uses.
+ *
+ *            For mm.c's NUMA mode, mem_numa_init adds one region per
+ *            node, each reserved like the first and bound to its node's
+ *            memory with mbind.  mem_set_node picks the region that
+ *            mem_sbrk and the mem_heap_* functions work on, so mm.c can
+ *            keep a separate heap in each.
+ *
+ *            With -DMEM_QUIET, running out of memory is only reported
+ *            through errno, not on stderr, since in libmm.so stderr
+ *            belongs to the host program.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <string.h>
 #include <errno.h>
+#include <linux/mempolicy.h>
 
 #include "memlib.h"
 #include "config.h"
@@ -18,6 +38,16 @@
 static char *mem_start_brk;  /* points to first byte of heap */
 static char *mem_brk;        /* points to last byte of heap */
 static char *mem_max_addr;   /* largest legal heap address */ 
+static size_t mem_sbrks;     /* mem_sbrk calls that grew a heap */
+
+/* NUMA regions; the one in use lives in the three variables above */
+static struct {
+    char *start_brk, *brk, *max_addr;
+} mem_nodes[MEM_MAX_NODES];
+static int mem_nnodes = 1;   /* regions */
+static int mem_cur = 0;      /* region in use */
+static int mem_real_nodes;   /* nodes the machine really has */
+static unsigned char mem_cpu_nodes[MEM_MAX_CPUS]; /* cpu -> real node */
 
 /* 
  * mem_init - initialize the memory system model
@@ -25,8 +55,10 @@ static char *mem_max_addr;   /* largest legal heap address */
 void mem_init(void)
 {
     /* allocate the storage we will use to model the available VM */
-    if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
-	fprintf(stderr, "mem_init_vm: malloc error\n");
+    mem_start_brk = mmap(NULL, MAX_HEAP, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem_start_brk == MAP_FAILED) {
+	fprintf(stderr, "mem_init_vm: mmap error\n");
 	exit(1);
     }
 
@@ -39,7 +71,13 @@ void mem_init(void)
  */
 void mem_deinit(void)
 {
-    free(mem_start_brk);
+    int i;
+
+    mem_set_node(0);
+    for (i = 1; i < mem_nnodes; i++)
+	munmap(mem_nodes[i].start_brk, MAX_HEAP);
+    mem_nnodes = 1;
+    munmap(mem_start_brk, MAX_HEAP);
 }
 
 /*
@@ -47,7 +85,18 @@ void mem_deinit(void)
  */
 void mem_reset_brk()
 {
-    mem_brk = mem_start_brk;
+    int cur = mem_cur, i;
+
+    for (i = mem_nnodes - 1; i >= 0; i--) {
+	mem_set_node(i);
+	/* Undo any mem_protect calls on the old heap */
+	if (mem_brk > mem_start_brk)
+	    mprotect(mem_start_brk, mem_brk - mem_start_brk, 
+		     PROT_READ | PROT_WRITE);
+	mem_brk = mem_start_brk;
+    }
+    mem_set_node(cur);
+    mem_sbrks = 0;
 }
 
 /* 
@@ -59,15 +108,172 @@ void *mem_sbrk(intptr_t incr)
 {
     char *old_brk = mem_brk;
 
-    if ( (incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
+    if ( (incr < 0) || (incr > mem_max_addr - mem_brk)) {
 	errno = ENOMEM;
+#ifndef MEM_QUIET
 	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
+#endif
 	return (void *)-1;
     }
     mem_brk += incr;
+    if (incr > 0)
+	mem_sbrks++;
     return (void *)old_brk;
 }
 
+/*
+ * mem_sbrk_calls - number of mem_sbrk calls that grew the heap (in any
+ *    region) since mem_init or the last mem_reset_brk
+ */
+size_t mem_sbrk_calls(void)
+{
+    return mem_sbrks;
+}
+
+/*
+ * mem_protect - set the access allowed to the whole pages in [addr,
+ *    addr+len) of the heap, with prot as for mprotect (e.g. PROT_NONE
+ *    for a guard page).  Returns 0 on success and -1 on error.
+ */
+int mem_protect(void *addr, size_t len, int prot)
+{
+    char *lo = addr;
+
+    if (lo < mem_start_brk || lo + len > mem_brk ||
+	(size_t)(lo - mem_start_brk) % mem_pagesize() != 0) {
+	errno = EINVAL;
+	return -1;
+    }
+    return mprotect(lo, len, prot);
+}
+
+/*
+ * read_cpulist - parse a sysfs CPU list such as "0-3,8-11" from path,
+ *    and record node as the node of each CPU in it
+ */
+static void read_cpulist(const char *path, int node)
+{
+    FILE *fp;
+    int lo, hi, c;
+
+    if ((fp = fopen(path, "r")) == NULL)
+	return;
+    while (fscanf(fp, "%d", &lo) == 1) {
+	hi = lo;
+	if ((c = getc(fp)) == '-') {
+	    if (fscanf(fp, "%d", &hi) != 1)
+		break;
+	    c = getc(fp);
+	}
+	for (; lo <= hi && lo < MEM_MAX_CPUS; lo++)
+	    mem_cpu_nodes[lo] = node;
+	if (c != ',')
+	    break;
+    }
+    fclose(fp);
+}
+
+/*
+ * mem_numa_init - split the memory system into nnodes regions, one per
+ *    NUMA node, or one per real node if nnodes <= 0.  More nodes than
+ *    the machine has are simulated: region i is bound to real node
+ *    i % (real nodes), and CPUs are dealt out to the simulated nodes
+ *    round robin.  Binding is a preference, so a full node spills over
+ *    rather than failing.  Call once, after mem_init; returns the
+ *    number of regions.
+ */
+int mem_numa_init(int nnodes)
+{
+    char path[64];
+    unsigned long mask;
+    int i, lo, hi;
+    FILE *fp;
+
+    /* Real topology from sysfs; one node if there is none */
+    mem_real_nodes = 1;
+    if ((fp = fopen("/sys/devices/system/node/possible", "r")) != NULL) {
+	if (fscanf(fp, "%d-%d", &lo, &hi) == 2)
+	    mem_real_nodes = hi + 1;
+	fclose(fp);
+    }
+    if (mem_real_nodes > MEM_MAX_NODES)
+	mem_real_nodes = MEM_MAX_NODES;
+    for (i = 0; i < mem_real_nodes; i++) {
+	sprintf(path, "/sys/devices/system/node/node%d/cpulist", i);
+	read_cpulist(path, i);
+    }
+
+    if (nnodes <= 0)
+	nnodes = mem_real_nodes;
+    if (nnodes > MEM_MAX_NODES)
+	nnodes = MEM_MAX_NODES;
+    for (i = mem_nnodes; i < nnodes; i++) {
+	mem_nodes[i].start_brk = mmap(NULL, MAX_HEAP, PROT_READ | PROT_WRITE,
+				      MAP_PRIVATE | MAP_ANONYMOUS | 
+				      MAP_NORESERVE, -1, 0);
+	if (mem_nodes[i].start_brk == MAP_FAILED) {
+	    fprintf(stderr, "mem_numa_init: mmap error\n");
+	    exit(1);
+	}
+	mem_nodes[i].brk = mem_nodes[i].start_brk;
+	mem_nodes[i].max_addr = mem_nodes[i].start_brk + MAX_HEAP;
+    }
+    mem_set_node(0);
+    mem_nnodes = nnodes;
+    for (i = 0; i < nnodes; i++) {
+	mask = 1UL << (i % mem_real_nodes);
+	syscall(SYS_mbind, i == 0 ? mem_start_brk : mem_nodes[i].start_brk,
+		MAX_HEAP, MPOL_PREFERRED, &mask, 8 * sizeof(mask), 0);
+    }
+    return nnodes;
+}
+
+/*
+ * mem_set_node - make region node the one that mem_sbrk and the
+ *    mem_heap_* functions use
+ */
+void mem_set_node(int node)
+{
+    if (node == mem_cur)
+	return;
+    mem_nodes[mem_cur].start_brk = mem_start_brk;
+    mem_nodes[mem_cur].brk = mem_brk;
+    mem_nodes[mem_cur].max_addr = mem_max_addr;
+    mem_start_brk = mem_nodes[node].start_brk;
+    mem_brk = mem_nodes[node].brk;
+    mem_max_addr = mem_nodes[node].max_addr;
+    mem_cur = node;
+}
+
+/*
+ * mem_node_of - return the region that holds address p, or -1
+ */
+int mem_node_of(const void *p)
+{
+    const char *cp = p;
+    int i;
+
+    if (cp >= mem_start_brk && cp < mem_max_addr)
+	return mem_cur;
+    for (i = 0; i < mem_nnodes; i++)
+	if (i != mem_cur && cp >= mem_nodes[i].start_brk && 
+	    cp < mem_nodes[i].max_addr)
+	    return i;
+    return -1;
+}
+
+/*
+ * mem_cpu_node - return the region for CPU cpu
+ */
+int mem_cpu_node(int cpu)
+{
+    if (cpu < 0 || cpu >= MEM_MAX_CPUS)
+	return 0;
+    if (mem_nnodes > mem_real_nodes)
+	return cpu % mem_nnodes;
+    return mem_cpu_nodes[cpu];
+}
+
 /*
  * mem_heap_lo - return address of the first heap byte
  */
@@ -1,7 +1,16 @@
+#define MEM_MAX_NODES 16    /* NUMA regions */
+#define MEM_MAX_CPUS 1024   /* CPUs mem_cpu_node knows */
+
 void mem_init(void);               
 void mem_deinit(void);
 void *mem_sbrk(intptr_t incr);
 void mem_reset_brk(void); 
+size_t mem_sbrk_calls(void);
+int mem_protect(void *addr, size_t len, int prot);
+int mem_numa_init(int nnodes);
+void mem_set_node(int node);
+int mem_node_of(const void *p);
+int mem_cpu_node(int cpu);
 void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
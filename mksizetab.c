@@ -0,0 +1,38 @@
+/*
+ * mksizetab.c - Generate sizetab.h, the size class tables of mm.c
+ *
+ * Usage: mksizetab > sizetab.h
+ *
+ * For every request size below MM_SMALL_MAX, rounded up to a
+ * doubleword, the table gives the block size and the bin that
+ * mm_malloc searches first; for every block size below MM_SMALL_MAX,
+ * the bin the block is kept in.  Both come from the MM_CLASS_SIZE and
+ * MM_SIZE_BIN macros in mm.h, so the tables can't disagree with the
+ * formulas mm.c uses for larger sizes.
+ */
+#include <stdio.h>
+#include <stddef.h>
+
+#include "mm.h"
+
+int main(void)
+{
+    size_t i, n = MM_SMALL_MAX / MM_DSIZE;
+
+    printf("/* Generated by mksizetab from mm.h; do not edit. */\n\n");
+    printf("/* Block size and first bin, by (request + DSIZE - 1) / DSIZE */\n");
+    printf("static const struct {\n\tunsigned short asize;\n"
+	   "\tunsigned char bin;\n} size_classes[%zu] = {\n", n + 1);
+    for (i = 0; i <= n; i++)
+	printf("\t{%zu, %d},\n", MM_CLASS_SIZE(i * MM_DSIZE),
+	       MM_SIZE_BIN(MM_CLASS_SIZE(i * MM_DSIZE)));
+    printf("};\n\n");
+
+    printf("/* Bin of a free block, by size / DSIZE */\n");
+    printf("static const unsigned char size_bins[%zu] = {", n);
+    for (i = 0; i < n; i++)
+	printf("%s%d,", i % 16 == 0 ? "\n\t" : " ",
+	       i * MM_DSIZE < 2 * MM_DSIZE ? 0 : MM_SIZE_BIN(i * MM_DSIZE));
+    printf("\n};\n");
+    return 0;
+}
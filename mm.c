@@ -15,14 +15,306 @@
 
 /* Submitted by: Ishita Chourasia   	 */ 
 
+#ifdef MM_NUMA
+#define _GNU_SOURCE		/* For sched_getcpu() */
+#include <sched.h>
+#endif
+#include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include<unistd.h>
+#include <sys/mman.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "memlib.h"
 #include "mm.h"
+#ifdef MM_SIZETAB
+#include MM_SIZETAB		/* sizetab.h generated for an MM_TUNE build */
+#else
+#include "sizetab.h"
+#endif
+#ifdef MM_ENGINE
+#include "mmengine.h"
+#define Add_Fb     MM_ENGINE_SYM(Add_Fb)
+#define Delete_Fb  MM_ENGINE_SYM(Delete_Fb)
+#endif
+
+/*
+ * With -DMM_HARDEN, heap metadata is protected against stray writes
+ * and misuse at a small cost on every request:
+ *  - the top 16 bits of every header and footer hold a checksum of the
+ *    rest of the word, keyed by a random per-heap secret;
+ *  - free list links are stored XORed with a second secret (as in
+ *    glibc's safe-linking, but with a random key instead of the link's
+ *    own address, which would lengthen the dependency chain of the
+ *    first-fit list walk), so an overwritten link decodes to a wild
+ *    pointer rather than an attacker's choice;
+ *  - mm_free and mm_realloc check the block's checksum and alloc bit,
+ *    which catches double frees in O(1), Delete_Fb checks that a block's
+ *    neighbors in its free list link back to it, and coalesce and place
+ *    check the checksums of the blocks they touch.
+ * Any failure is reported on stderr and aborts.
+ */
+/*
+ * With -DMM_GUARD, mm.c becomes a debugging allocator that doesn't use
+ * the free lists at all.  Every block gets its own run of pages from
+ * mem_sbrk, with the payload placed at the end of the run, just below
+ * a guard page that mem_protect makes inaccessible.  A read or write
+ * past the end of the block faults at the offending instruction (the
+ * few bytes of alignment padding in between are filled with a pattern
+ * that mm_free checks).  A freed block's pages are made inaccessible
+ * too, so a use after free, or a second free, faults as well.  Freed
+ * runs wait in a FIFO quarantine of GUARD_QUARANTINE blocks before they
+ * are made accessible again and reused.  This costs two or more pages
+ * and a few system calls per block, so it is only for debugging.
+ */
+#ifdef MM_GUARD
+#ifndef GUARD_QUARANTINE
+#define GUARD_QUARANTINE 1024	/* Freed blocks held before reuse */
+#endif
+#define GUARD_FILL 0xcb		/* Fills the padding after a payload */
+
+/* Lies just below each payload. */
+struct guard_hdr {
+	size_t npages;		/* Pages in the run, guard page included */
+	size_t size;		/* Requested payload size */
+};
+
+/* Lies at the start of each run that is free for reuse. */
+struct guard_run {
+	struct guard_run *next;
+	size_t npages;
+};
+
+static size_t guard_pagesize;
+static struct guard_run *guard_runs;	/* Runs out of quarantine */
+static char *guard_fifo[GUARD_QUARANTINE];	/* Quarantined runs ... */
+static size_t guard_fifo_npages[GUARD_QUARANTINE];	/* ... and sizes */
+static int guard_fifo_head, guard_fifo_count;
+#endif
+
+/*
+ * With -DMM_BUDDY, mm.c becomes a binary buddy allocator, for comparing
+ * against the boundary-tag allocator on the same traces.  Every block
+ * is DSIZE << k bytes for some order k, starts at a multiple of its own
+ * size from the start of the heap, and has no header or footer.  A
+ * block's buddy is the other half of the block of order k + 1 that it
+ * was split from; its offset differs only in bit k, so finding it is an
+ * XOR, and coalescing merges a freed block with its buddy for as long
+ * as the buddy is free and whole.  Free blocks are on one doubly linked
+ * list per order, with a bitmap of the non-empty lists, so malloc finds
+ * the smallest free block of the right order or above with one count-
+ * trailing-zeros instruction and halves it down to size.  Rounding every
+ * request up to a power of two wastes up to half of each block; the
+ * "ifrag" column of mdriver -v measures that.  The order of each block
+ * and whether it is free are kept in two side tables with an entry per
+ * doubleword (a byte and a bit), which are mmap'ed outside the heap and
+ * not counted by mem_heapsize.
+ */
+#ifdef MM_BUDDY
+#if defined(MM_GUARD) || defined(MM_QUARANTINE) || defined(MM_HARDEN) || \
+    defined(MM_NUMA) || defined(MM_TLSF)
+#error "MM_BUDDY can't be combined with the other allocator modes"
+#endif
+#define BUDDY_ORDERS   40		/* Orders 0 .. 39, DSIZE to 8 TB */
+#define BUDDY_MIN      (1 << 16)	/* Doublewords covered by new tables */
+#define BUDDY_BLOCK(u) (buddy_base + (u) * DSIZE)
+#define BUDDY_UNIT(bp) ((size_t)((char *)(bp) - buddy_base) / DSIZE)
+#define BUDDY_ISFREE(u) ((buddy_isfree[(u) / 64] >> ((u) % 64)) & 1)
+
+/* Lies at the start of each free block, and is each list's head. */
+struct buddy_link {
+	struct buddy_link *next, *prev;
+};
+
+static char *buddy_base;		/* Start of the heap */
+static size_t buddy_top;		/* Doublewords in the heap */
+static size_t buddy_cap;		/* Doublewords the side tables cover */
+static struct buddy_link buddy_lists[BUDDY_ORDERS];	/* Circular lists */
+static uint64_t buddy_map;		/* Bit k set iff list k is non-empty */
+static unsigned char *buddy_order;	/* Order of the block at each unit */
+static uint64_t *buddy_isfree;		/* Bit u set iff a free block starts at u */
+#endif
+
+/*
+ * With -DMM_QUARANTINE, mm_free doesn't free a block right away.  It
+ * fills the payload (up to POISON_MAX bytes of it) with POISON_BYTE,
+ * marks the block as quarantined and appends it to a FIFO, linked
+ * through the payload's first word.
+ * Once the quarantined blocks add up to more than QUARANTINE_BYTES,
+ * the oldest are checked and really freed; a byte that is no longer
+ * poison means the program wrote to the block after freeing it.
+ * Freeing a quarantined block again is reported as a double free.
+ * Poisoning whole payloads triples the cost of the generated traces,
+ * which free many large blocks; most writes after free hit the first
+ * fields of a block, so by default only a prefix is poisoned.
+ * -DPOISON_MAX=SIZE_MAX poisons everything.
+ */
+#ifdef MM_QUARANTINE
+#ifndef QUARANTINE_BYTES
+#define QUARANTINE_BYTES (256 * 1024)	/* Bytes held before freeing */
+#endif
+#ifndef POISON_MAX
+#define POISON_MAX 256			/* Bytes poisoned per block */
+#endif
+#define POISON_BYTE 0xdf
+#define POISON_WORD ((uintptr_t)0xdfdfdfdfdfdfdfdfULL)
+#define QUARANTINED 0x2			/* Header bit of a quarantined block */
+static char *qhead, *qtail;		/* Oldest and newest quarantined block */
+static size_t qbytes;			/* Total size of the quarantined blocks */
+#endif
+
+#ifdef MM_HARDEN
+#if UINTPTR_MAX <= 0xffffffff
+#error "MM_HARDEN needs 64-bit words for the header checksums"
+#endif
+#include <time.h>
+#include <sys/random.h>
+static uintptr_t tag_secret;		/* Key for header checksums */
+static uintptr_t link_secret;		/* Key for free list links */
+#endif
+
+/*
+ * With -DMM_TLSF, the free lists are organized as in TLSF (two-level
+ * segregated fit) instead of as MM_NBINS bins, so that every request
+ * takes a bounded amount of time.  Block sizes are divided into powers
+ * of two (the first level), and each power of two into TLSF_SL equal
+ * ranges (the second level), with one list per range; sizes below
+ * TLSF_LINEAR have a list each.  A bitmap of the non-empty first-level
+ * classes and one of the non-empty lists in each class replace the
+ * walk over the bins.  find_fit rounds the request up to the start of
+ * the next range, so that any block on the first non-empty list at or
+ * above it fits, and finds that list with at most two count-trailing-
+ * zeros instructions: a good fit, rather than the first fit, at the
+ * cost of up to 1/TLSF_SL of the request in rounding.  Only blocks too
+ * large for the last first-level class share a list that is searched.
+ * The block format, coalescing and the rest of mm.c are unchanged.
+ * There are TLSF_LISTS list heads, which are kept outside the heap.
+ */
+#ifdef MM_TLSF
+#define TLSF_SLI    4		/* log2 of the second-level lists per class */
+#define TLSF_SL     (1 << TLSF_SLI)
+#define TLSF_FL     31		/* First-level classes, up to 2^37 bytes */
+#define TLSF_LISTS  (TLSF_FL * TLSF_SL)
+#define TLSF_LINEAR (TLSF_SL * 2 * sizeof(void *))	/* Sizes with a list each */
+#define TLSF_SHIFT  (MM_LOG2(TLSF_LINEAR) - 1)	/* log2 of class 1, minus 1 */
+#ifdef MM_NUMA
+#define TLSF_ARENAS MEM_MAX_NODES
+#else
+#define TLSF_ARENAS 1
+#endif
+static char tlsf_heads[TLSF_ARENAS][TLSF_LISTS * 2 * sizeof(void *)]
+    __attribute__((aligned(16)));
+static uint32_t fl_map;			/* Bit f set iff class f is non-empty */
+static uint32_t sl_map[TLSF_FL];	/* Bit s set iff list (f, s) is non-empty */
+#endif
+
+/*
+ * The large bins (MM_SMALL_BINS and up) hold blocks of many sizes, so
+ * find_fit has to compare sizes there, and reading each block's header
+ * on the way down its free list costs a cache miss per block.  So each
+ * large bin that find_fit finds holding FIT_BUILD or more blocks gets
+ * a fit index: packed arrays of the sizes (in doublewords) and
+ * addresses of its blocks, in the order they were added.  find_fit
+ * scans the sizes from the end, four at a time with SSE2, which visits
+ * the blocks in the same order as the list (newest first) but reads 16
+ * sizes per cache line and touches only the block it picks.  A free
+ * block in an indexed bin keeps its position in the arrays in its
+ * third payload word (FIT_SLOT).  Delete_Fb just zeroes the block's
+ * size entry; the dead entries are squeezed out when the arrays fill
+ * up, and the index is dropped when the bin empties.  Short bins, like
+ * the one holding the wilderness block that is split and merged on
+ * almost every request, are cheaper to search through the list than
+ * to index.  The arrays are mmap'ed outside the heap, and if that
+ * fails, the bin is searched through its list instead.
+ */
+#define FIT_BINS   (MM_NBINS - MM_SMALL_BINS)	/* Bins with a fit index */
+#define FIT_BUILD  16		/* Blocks in a bin before it is indexed */
+#define FIT_MIN    1024		/* Entries in a new fit index */
+#define FIT_SLOT(bp)  (*(size_t *)((char *)(bp) + 2 * sizeof(void *)))
+
+struct fit_index {
+	uint32_t *sizes;	/* Block sizes / DSIZE, 0 if deleted */
+	void **blocks;		/* Block addresses */
+	size_t n, cap;		/* Entries used and allocated */
+	size_t dead;		/* Deleted entries among the first n */
+	bool on;		/* The bin is indexed */
+};
+
+/*
+ * With -DMM_NUMA, there is a separate heap (arena) for every NUMA node,
+ * each in its own memlib region, which memlib binds to that node's
+ * memory.  The variables below (heap_listp, htp and the statistics)
+ * always describe the current arena; numa_switch saves them and loads
+ * another arena's, which only happens when consecutive requests are for
+ * different nodes.  mm_malloc and mm_memalign use the arena of the node
+ * the calling CPU is on, or the node the calling thread chose with
+ * mm_numa_set_node, and mm_free and mm_realloc the arena that holds the
+ * block.  MM_NUMA_NODES=<n> in the environment simulates n nodes on a
+ * machine with fewer (see mem_numa_init), exercising the same code.
+ */
+#ifdef MM_NUMA
+#if defined(MM_GUARD) || defined(MM_QUARANTINE)
+#error "MM_NUMA can't be combined with MM_GUARD or MM_QUARANTINE"
+#endif
+struct arena {
+	char *heap_listp, *htp;
+	size_t bin_bytes[MM_NBINS], bin_blocks[MM_NBINS];
+	size_t alloc_blocks, peak_heap;
+	size_t grow, nmallocs, last_grow;
+	uint64_t bin_map;
+	struct fit_index fits[FIT_BINS];
+#ifdef MM_TLSF
+	uint32_t fl_map, sl_map[TLSF_FL];
+#endif
+#ifdef MM_CHECK
+	char *check_cursor;
+#endif
+};
+static struct arena arenas[MEM_MAX_NODES];
+static int numa_narenas;		/* 0 until the first mm_init */
+static int cur_arena;			/* Arena in the global variables */
+static __thread int numa_node = -1;	/* Set by mm_numa_set_node */
+#define NUMA_SWITCH(a) do {						\
+	if ((a) != cur_arena)						\
+		numa_switch(a);						\
+} while (0)
+#else
+#define NUMA_SWITCH(a)
+#endif
+
+/*
+ * With -DMM_PROFILE, a sampling heap profiler (mmprof.c) records the
+ * call stacks of about one allocation per MMPROF_PERIOD bytes.  An
+ * unsampled mm_malloc pays one subtract-and-branch, and mm_free one
+ * branch while no sampled block is live.
+ */
+#ifdef MM_PROFILE
+#include "mmprof.h"
+#define PROF_MALLOC(bp, size) do {					\
+	if ((mmprof_countdown -= (long)(size)) < 0)			\
+		mmprof_sample(bp, size);				\
+} while (0)
+#define PROF_FREE(bp) do {						\
+	if (mmprof_nlive != 0)						\
+		mmprof_free(bp);					\
+} while (0)
+#define PROF_MOVE(oldbp, newbp) do {					\
+	if (mmprof_nlive != 0)						\
+		mmprof_move(oldbp, newbp);				\
+} while (0)
+#define PROF_RESET() mmprof_reset()
+#else
+#define PROF_MALLOC(bp, size)
+#define PROF_FREE(bp)
+#define PROF_MOVE(oldbp, newbp)
+#define PROF_RESET()
+#endif
 
 /*********************************************************
  * NOTE TO STUDENTS: Before you do anything else, please
@@ -37,19 +329,38 @@ team_t team = {
 /* Basic constants and macros: */
 #define WSIZE      sizeof(void *) /* Word and header/footer size (bytes) */
 #define DSIZE      (2 * WSIZE)    /* Doubleword size (bytes) */
-#define CHUNKSIZE  (1 << 12)      /* Extend heap by this amount (bytes) */
+#ifndef MM_CHUNKSIZE
+#define MM_CHUNKSIZE  (1 << 12)
+#endif
+#ifndef MM_SPLIT_MIN
+#define MM_SPLIT_MIN  (2 * DSIZE)
+#endif
+#ifndef MM_PLACE_HIGH
+#define MM_PLACE_HIGH  0
+#endif
+#define CHUNKSIZE  (params.chunksize)  /* Extend heap by at least this amount (bytes) */
+#define GROW_WINDOW 256	/* Growth of a chunk per this many requests is fast */
+#define GROW_FRAC   8	/* The growth increment is at most 1/GROW_FRAC of the heap */
 
 #define MAX(x, y)  ((x) > (y) ? (x) : (y))  
-
-/* Pack a size and allocated bit into a word. */
+#define MIN(x, y)  ((x) < (y) ? (x) : (y))
+
+/* Pack a size and allocated bit into a word (with its checksum, if any). */
+#ifdef MM_HARDEN
+#define TAG_MASK   ((uintptr_t)0xffff << 48)
+#define TAG(val)   ((((uintptr_t)(val) ^ tag_secret) * 0x9e3779b97f4a7c15ULL) & TAG_MASK)
+#define PACK(size, alloc)  ((size) | (alloc) | TAG((size) | (alloc)))
+#else
+#define TAG_MASK   ((uintptr_t)0)
 #define PACK(size, alloc)  ((size) | (alloc))    
+#endif
 
 /* Read and write a word at address p. */
 #define GET(p)       (*(uintptr_t *)(p))
 #define PUT(p, val)  (*(uintptr_t *)(p) = (val))
 
 /* Read the size and allocated fields from address p. */
-#define GET_SIZE(p)   (GET(p) & ~(DSIZE - 1))
+#define GET_SIZE(p)   (GET(p) & ~(DSIZE - 1) & ~TAG_MASK)
 #define GET_ALLOC(p)  (GET(p) & 0x1)
 
 /* Given block ptr bp, compute address of its header and footer. */
@@ -60,12 +371,64 @@ team_t team = {
 #define NEXT_BLKP(bp)  ((char *)(bp) + GET_SIZE(((char *)(bp) - WSIZE)))
 #define PREV_BLKP(bp)  ((char *)(bp) - GET_SIZE(((char *)(bp) - DSIZE)))
 
+/* Is the free block bp the wilderness, the one before the epilogue? */
+#define IS_WILD(bp)  (GET_SIZE(HDRP(NEXT_BLKP(bp))) == 0)
+
+
+/* Encode or decode a free list link. */
+#ifdef MM_HARDEN
+#define MANGLE(ptr) ((void *)((uintptr_t)(ptr) ^ link_secret))
+#else
+#define MANGLE(ptr) ((void *)(ptr))
+#endif
 
 #define NEXT_FREE(bp) *(int *)(bp)
-#define PreviousFreeBlock(ptr) (*(void **) (ptr))	// This returns the previous free block in the explicitly maitained free list
-#define NextFreeBlock(ptr) (*(void **) (ptr + WSIZE))	// This returns the next free block in the explicitly maitained free list
-#define SetPreviousFree(bp, previous) (*((void **)(bp)) = previous)
-#define SetNextFree(bp, next) (*((void **)(bp + WSIZE)) = next)
+#define PreviousFreeBlock(ptr) MANGLE(*(void **)(ptr))	// This returns the previous free block in the explicitly maitained free list
+#define NextFreeBlock(ptr) MANGLE(*(void **)((char *)(ptr) + WSIZE))	// This returns the next free block in the explicitly maitained free list
+#define SetPreviousFree(bp, previous) (*((void **)(bp)) = MANGLE(previous))
+#define SetNextFree(bp, next) (*((void **)((char *)(bp) + WSIZE)) = MANGLE(next))
+
+/* Abort unless the header or footer word at p has a valid checksum. */
+#ifdef MM_HARDEN
+#define TAG_OK(p)  (TAG(GET(p) & ~TAG_MASK) == (GET(p) & TAG_MASK))
+#define HARDEN_TAG(p, bp) do {						\
+	if (!TAG_OK(p))							\
+		harden_fail("corrupted block header or footer", (bp));	\
+} while (0)
+#else
+#define TAG_OK(p)  true
+#define HARDEN_TAG(p, bp)
+#endif
+
+/*
+ * Index of the free list (bin) that holds free blocks of the given size,
+ * and the block size for a request of "size" bytes (see MM_SIZE_BIN and
+ * MM_CLASS_SIZE in mm.h).  Small sizes are looked up in the tables in
+ * sizetab.h, and large bins are found with a count of leading zeros;
+ * blocks too large for the params.nbins bins in use share the last.
+ */
+#define BIN(size)  ((size) < MM_SMALL_MAX ? size_bins[(size) / DSIZE] :	\
+	MIN(MM_LARGE_BIN(size), params.nbins - 1))
+#define ASIZE(size)  ((size) < MM_SMALL_MAX ?				\
+	size_classes[((size) + DSIZE - 1) / DSIZE].asize : MM_CLASS_SIZE(size))
+#ifdef MM_TLSF
+#define LIST(size) tlsf_list(size)	/* List that holds a free block */
+#define NLISTS     TLSF_LISTS
+#define NHEADS     TLSF_LISTS
+#else
+#define LIST(size) BIN(size)
+#define NLISTS     params.nbins
+#define NHEADS     params.nbins	/* List heads allocated at htp */
+#endif
+
+/*
+ * Parameters set by mm_set_params, and the copy that mm_init took of
+ * them for the current heap.
+ */
+static struct mm_params next_params =
+    {MM_CHUNKSIZE, MM_SPLIT_MIN, MM_NBINS, MM_PLACE_HIGH};
+static struct mm_params params =
+    {MM_CHUNKSIZE, MM_SPLIT_MIN, MM_NBINS, MM_PLACE_HIGH};
 
 /* Global variables: */
 static char *heap_listp; /* Pointer to first block */  	
@@ -73,15 +436,99 @@ static char *heap_listp; /* Pointer to first block */
 static char *htp;			//This is the pointer pointing to the heap
 static char *head;  			//This is the pointer used to maintain the explicit free list
 
+/* Statistics maintained incrementally for mm_stats(): */
+static size_t bin_bytes[MM_NBINS];	/* Bytes in the free blocks of each bin */
+static size_t bin_blocks[MM_NBINS];	/* Number of free blocks in each bin */
+static uint64_t bin_map;		/* Bit i set iff bin i is non-empty */
+static struct fit_index fits[FIT_BINS];	/* Fit index of each large bin */
+static size_t alloc_blocks;		/* Number of allocated blocks */
+static size_t peak_heap;		/* Largest heap size seen */
+
+/* Heap growth (see grow_heap): */
+static size_t grow;			/* Least amount to extend the heap by */
+static size_t nmallocs;			/* Blocks allocated since mm_init */
+static size_t last_grow;		/* nmallocs at the last extension */
+
+/*
+ * With -DMM_CHECK, every mm_malloc also checks the next CHECK_SLICE
+ * blocks of the heap, picking up where the previous call stopped and
+ * starting over at the first block after the last, and aborts if any
+ * of them is corrupt.  The whole heap is covered every few thousand
+ * requests at a bounded cost per request.  check_cursor is moved back
+ * whenever the block it points to is merged into a neighbor.
+ */
+#ifdef MM_CHECK
+#ifndef CHECK_SLICE
+#define CHECK_SLICE 4
+#endif
+static char *check_cursor;		/* Next block to check */
+#define CHECK_MERGED(bp, into) do {					\
+	if (check_cursor == (char *)(bp))				\
+		check_cursor = (char *)(into);				\
+} while (0)
+#else
+#define CHECK_MERGED(bp, into)
+#endif
+
 /* Function prototypes for internal helper routines: */
 static void *coalesce(void *bp);		//Coalesces a newly created free block with its adjacent blocks after checking the 							//necessary conditions
-static void *extend_heap(size_t words);		// This routine extends the heap to a predefined size known as chunk size.
-static void *find_fit(size_t asize);		// This is the key routine which finds the necessary free block of appropriate size for 						//allocation 
-static void place(void *bp, size_t asize);
+static void *extend_heap(size_t words);
+static void *wilderness(void);
+static void *grow_heap(size_t asize);		// This routine extends the heap to a predefined size known as chunk size.
+static void *malloc_class(size_t size, size_t asize, int bin);
+static void *find_fit(size_t asize, int bin);		// This is the key routine which finds the necessary free block of appropriate size for 						//allocation 
+static void *place(void *bp, size_t asize);
+#ifdef MM_TLSF
+static inline int tlsf_list(size_t size);
+#else
+static bool fit_grow(struct fit_index *fi, size_t cap);
+static void fit_build(struct fit_index *fi, int num);
+static void fit_add(struct fit_index *fi, void *bp, size_t size);
+static void fit_delete(struct fit_index *fi, void *bp);
+static void *fit_search(const struct fit_index *fi, size_t asize);
+#endif
+
+#ifdef MM_GUARD
+static void *guard_alloc(size_t size, size_t alignment);
+static void guard_free(void *bp);
+static void *guard_realloc(void *bp, size_t size);
+#endif
+#ifdef MM_BUDDY
+static int buddy_init(void);
+static void *buddy_alloc(size_t size, size_t alignment);
+static void buddy_free(void *bp);
+static void *buddy_realloc(void *bp, size_t size);
+static int buddy_order_of(size_t size);
+static bool buddy_extend(int k);
+static void buddy_push(size_t u, int k);
+static void buddy_unlink(size_t u, int k);
+static void buddy_release(size_t u, int k);
+static void buddy_stats(struct mm_stats *st);
+static int buddy_check(int verbose);
+#endif
+#ifdef MM_QUARANTINE
+static void quarantine(void *bp);
+#endif
+#ifdef MM_HARDEN
+static void harden_fail(const char *what, void *bp)
+    __attribute__((noreturn));
+static void harden_block(void *bp);
+#endif
+#ifdef MM_NUMA
+static void numa_switch(int a);
+static int numa_local(void);
+#endif
+static int init_heap(void);
+static void arena_stats(struct mm_stats *st);
+static int checkarena(int verbose);
 
 /* Function prototypes for heap consistency checker routines: */
-static void checkblock(void *bp);
-static void checkheap(bool verbose);
+static bool in_heap(const void *p);
+static int checkblock(void *bp);
+static int checkfree(void *bp);
+#ifdef MM_CHECK
+static void checkslice(void);
+#endif
 static void printblock(void *bp); 
 
 //Routines added for adding and deleting blocks
@@ -99,7 +546,71 @@ void Delete_Fb(void *bp,size_t size_of_block); //For deleting newly allocated bl
 int
 mm_init(void) 
 {
-	htp=mem_sbrk(55*DSIZE); 			// Lists being created
+
+	params = next_params;
+#ifdef MM_GUARD
+	guard_pagesize = mem_pagesize();
+	guard_runs = NULL;
+	guard_fifo_head = guard_fifo_count = 0;
+	alloc_blocks = 0;
+	peak_heap = 0;
+	return (0);
+#endif
+#ifdef MM_BUDDY
+	return (buddy_init());
+#endif
+#ifdef MM_HARDEN
+	if (getrandom(&tag_secret, sizeof(tag_secret), GRND_NONBLOCK) !=
+	    sizeof(tag_secret) ||
+	    getrandom(&link_secret, sizeof(link_secret), GRND_NONBLOCK) !=
+	    sizeof(link_secret)) {
+		tag_secret = (uintptr_t)time(NULL) * 0x9e3779b97f4a7c15ULL;
+		link_secret = (uintptr_t)&tag_secret ^ (tag_secret >> 17);
+	}
+#endif
+#ifdef MM_NUMA
+	int a;
+
+	if (numa_narenas == 0) {
+		numa_narenas = mem_numa_init(getenv("MM_NUMA_NODES") != NULL ?
+		    atoi(getenv("MM_NUMA_NODES")) : 0);
+		cur_arena = 0;
+	}
+	/* Build every arena's heap, leaving arena 0 current. */
+	for (a = numa_narenas - 1; a >= 0; a--) {
+		NUMA_SWITCH(a);
+		if (init_heap() == -1)
+			return (-1);
+	}
+	return (0);
+#else
+	return (init_heap());
+#endif
+}
+
+/* 
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Create an empty heap in the current memlib region.  Returns 0 if
+ *   successful and -1 otherwise.
+ */
+static int
+init_heap(void)
+{
+
+#ifdef MM_TLSF
+#ifdef MM_NUMA
+	htp = tlsf_heads[cur_arena];
+#else
+	htp = tlsf_heads[0];
+#endif
+	fl_map = 0;
+	memset(sl_map, 0, sizeof(sl_map));
+#else
+	htp=mem_sbrk(NHEADS*DSIZE); 			// Lists being created
+#endif
 	/* Create the initial empty heap. */
 	if ((heap_listp = mem_sbrk(4 * WSIZE)) == (void *)-1)
 		return (-1);
@@ -112,10 +623,29 @@ mm_init(void)
 	
 	int lk=0;
 	head=htp;
-	while(lk<55){
+	while(lk<NHEADS){
 		SetNextFree(htp+lk*DSIZE,0); 		// Initialize head to NULL ( yet no free block )
 		++lk;
 	}
+	memset(bin_bytes, 0, sizeof(bin_bytes));
+	memset(bin_blocks, 0, sizeof(bin_blocks));
+	bin_map = 0;
+	for (lk = 0; lk < FIT_BINS; lk++) {
+		fits[lk].n = fits[lk].dead = 0;
+		fits[lk].on = false;
+	}
+	alloc_blocks = 0;
+	peak_heap = 0;
+	grow = CHUNKSIZE;
+	nmallocs = last_grow = 0;
+	PROF_RESET();
+#ifdef MM_CHECK
+	check_cursor = NULL;
+#endif
+#ifdef MM_QUARANTINE
+	qhead = qtail = NULL;
+	qbytes = 0;
+#endif
 
 	if (extend_heap(CHUNKSIZE/WSIZE) == (void *)-1)/* Extend the empty heap with a free block of CHUNKSIZE bytes */
 	return (-1);
@@ -135,31 +665,82 @@ mm_init(void)
 void *
 mm_malloc(size_t size) 
 {
-	size_t asize;      /* Adjusted block size */
-	size_t extendsize; /* Amount to extend heap if no fit */
-	void *bp;		// amount to extend heap if no fit 
 
 	/* Ignore spurious requests. */
 	if (size == 0)		//No allocation done due to empty space
 		return (NULL);
 
-	/* Adjust block size to include overhead and alignment reqs. */
-	if (size <= DSIZE)
-		asize = 2 * DSIZE;
-	else
-		asize = DSIZE * ((size + DSIZE + (DSIZE - 1)) / DSIZE);
+	/* Small requests look up their block size and bin. */
+	if (size < MM_SMALL_MAX)
+		return (malloc_class(size,
+		    size_classes[(size + DSIZE - 1) / DSIZE].asize,
+		    size_classes[(size + DSIZE - 1) / DSIZE].bin));
+	if (size > MM_REQUEST_MAX) {
+		errno = ENOMEM;
+		return (NULL);
+	}
+	return (malloc_class(size, MM_CLASS_SIZE(size),
+	    BIN(MM_CLASS_SIZE(size))));
+}
+
+/* 
+ * Requires:
+ *   "size" is positive, "asize" is MM_CLASS_SIZE(size) and "bin" is
+ *   MM_SIZE_BIN(asize).
+ *
+ * Effects:
+ *   mm_malloc with the size class already worked out, as by
+ *   mm_malloc_inline in mm.h.
+ */
+void *
+mm_malloc_class(size_t size, size_t asize, int bin)
+{
+
+	return (malloc_class(size, asize, bin));
+}
+
+/* 
+ * Requires:
+ *   "size" is positive, "asize" is MM_CLASS_SIZE(size) and "bin" is
+ *   MM_SIZE_BIN(asize).
+ *
+ * Effects:
+ *   Allocate a block of "asize" bytes for a request of "size" bytes.
+ *   Returns the address of the block if the allocation was successful
+ *   and NULL otherwise.
+ */
+static inline void *
+malloc_class(size_t size, size_t asize, int bin)
+{
+	void *bp;
+
+	(void)size;	/* Only the guard page mode and the profiler use it. */
+#ifdef MM_GUARD
+	return (guard_alloc(size, DSIZE));
+#endif
+#ifdef MM_BUDDY
+	return (buddy_alloc(size, DSIZE));
+#endif
+	NUMA_SWITCH(numa_local());
+#ifdef MM_CHECK
+	checkslice();
+#endif
+	nmallocs++;
 
 	/* Search the free list for a fit. */
-	if ((bp = find_fit(asize)) != NULL) {
-		place(bp, asize);	//places th block in the list
+	if ((bp = find_fit(asize, bin)) != NULL) {
+		bp = place(bp, asize);	//places th block in the list
+		alloc_blocks++;
+		PROF_MALLOC(bp, size);
 		return (bp);
 	}
 
 	/* No fit found.  Get more memory and place the block. */
-	extendsize = MAX(asize, CHUNKSIZE);			// calculates the max of the total required size and the previously 									//provided chunk size
-	if ((bp = extend_heap(extendsize / WSIZE)) == NULL)  //if the size requirments is not met, extends the size of the heap 
+	if ((bp = grow_heap(asize)) == NULL)
 		return (NULL);
-	place(bp, asize);		//placing of block into heap 
+	bp = place(bp, asize);		//placing of block into heap 
+	alloc_blocks++;
+	PROF_MALLOC(bp, size);
 	return (bp);
 } 
 
@@ -179,11 +760,30 @@ mm_free(void *bp)
 	if (bp == NULL)
 		return;
 
+#ifdef MM_GUARD
+	guard_free(bp);
+	return;
+#endif
+#ifdef MM_BUDDY
+	buddy_free(bp);
+	return;
+#endif
+	NUMA_SWITCH(mem_node_of(bp));
+#ifdef MM_HARDEN
+	harden_block(bp);
+#endif
+	PROF_FREE(bp);
+#ifdef MM_QUARANTINE
+	quarantine(bp);
+	return;
+#endif
+
 	/* Free and coalesce the block. */
 	size = GET_SIZE(HDRP(bp));
 	PUT(HDRP(bp), PACK(size, 0));	// Packs the size of the block and the allocation status of the block in the header
 	PUT(FTRP(bp), PACK(size, 0));	// Packs the size of the block and the allocation status of the block in the footer
 	coalesce(bp);			// coalesces the newly block in the explicictly maintained list
+	alloc_blocks--;
 }
 
 /* Add_Fb : This will add a free block to the explicitly maintained free list . If a free block is to be allocated, traverse the free list. It follows the lifo property similar to stack */ 
@@ -193,12 +793,21 @@ void Add_Fb(void *bp,size_t size_of_block) {  		//Adding the newly created free
 	//Doing by stack property
     void *ptr = bp;
 
-	int num=size_of_block/6000;//Hash index calculation
-	if(num>=50)
-	   num=49;
+	int num=BIN(size_of_block);//Hash index calculation
+	int list = LIST(size_of_block);
 	char *p=htp;
 
-	head=p+DSIZE*num; //Direct's the function to particular list
+	head=p+DSIZE*list; //Direct's the function to particular list
+	bin_bytes[num] += size_of_block;
+	if (bin_blocks[num]++ == 0)
+		bin_map |= (uint64_t)1 << num;
+#ifdef MM_TLSF
+	sl_map[list / TLSF_SL] |= (uint32_t)1 << (list % TLSF_SL);
+	fl_map |= (uint32_t)1 << (list / TLSF_SL);
+#else
+	if (num >= MM_SMALL_BINS)
+		fit_add(&fits[num - MM_SMALL_BINS], bp, size_of_block);
+#endif
 
 	if(NextFreeBlock(head)==0){
 		SetNextFree(head,ptr);// Pointer rearrangement 
@@ -219,17 +828,32 @@ void Add_Fb(void *bp,size_t size_of_block) {  		//Adding the newly created free
  is extended while coalescing. The link of the free list is removed from the explicitly maintained list*/
  
 void Delete_Fb(void *bp, size_t size_of_block) {
-	int num	= size_of_block/6000; // Hash Index
-	if(num >= 50)
-		num = 49;
+	int num	= BIN(size_of_block); // Hash Index
+	int list = LIST(size_of_block);
 	char *p = htp;
-	head = p+DSIZE*num;
+	head = p+DSIZE*list;
 	void *next_blk = (void *) NextFreeBlock(bp); // Next free block pointer
 	void *previous_blk = (void *) PreviousFreeBlock(bp);// Previous free block pointer
-	if(*(void **)(head + WSIZE)==0)
+	if(NextFreeBlock(head)==0)
 		return;
-	
 	else{
+#ifdef MM_HARDEN
+		if (NextFreeBlock(previous_blk) != bp ||
+		    (next_blk != 0 && PreviousFreeBlock(next_blk) != bp))
+			harden_fail("corrupted free list", bp);
+#endif
+		bin_bytes[num] -= size_of_block;
+		if (--bin_blocks[num] == 0)
+			bin_map &= ~((uint64_t)1 << num);
+#ifdef MM_TLSF
+		if (previous_blk == head && next_blk == 0 &&
+		    (sl_map[list / TLSF_SL] &= ~((uint32_t)1 <<
+		    (list % TLSF_SL))) == 0)
+			fl_map &= ~((uint32_t)1 << (list / TLSF_SL));
+#else
+		if (num >= MM_SMALL_BINS)
+			fit_delete(&fits[num - MM_SMALL_BINS], bp);
+#endif
 		if (previous_blk == head && next_blk!=0) {
 		SetNextFree(head,next_blk); 	// Sets the next block in the list to free
 		SetPreviousFree(next_blk,head);	// Sets the previous block in the list to free
@@ -272,8 +896,6 @@ mm_realloc(void *ptr, size_t size)
 	size_t total_size; 
 	void *newptr;
 	
-		oldsize = GET_SIZE(HDRP(ptr));			// Gets the present size of the allocated block which has to be 								//reallocated	
-	
 	/* If size == 0 then this is just free, and we return NULL. */
 	if (size == 0) {
 		mm_free(ptr);				//this frees the block
@@ -283,11 +905,24 @@ mm_realloc(void *ptr, size_t size)
 	/* If oldptr is NULL, then this is just malloc. */
 	if (ptr == NULL)
 		return (mm_malloc(size));		// allocates the block of the mentioned size
+	if (size > MM_REQUEST_MAX) {
+		errno = ENOMEM;
+		return (NULL);
+	}
 
-	if (size <= DSIZE)
-		total_size = 2 * DSIZE;
-			else
-		total_size = DSIZE * ((size + DSIZE + (DSIZE - 1)) / DSIZE);//total_size required for the new block to be allocated
+#ifdef MM_GUARD
+	return (guard_realloc(ptr, size));
+#endif
+#ifdef MM_BUDDY
+	return (buddy_realloc(ptr, size));
+#endif
+	NUMA_SWITCH(mem_node_of(ptr));
+#ifdef MM_HARDEN
+	harden_block(ptr);
+#endif
+	oldsize = GET_SIZE(HDRP(ptr));			// Gets the present size of the allocated block which has to be 								//reallocated	
+
+	total_size = ASIZE(size);	//total_size required for the new block to be allocated
 	if(oldsize == total_size) return ptr;
 	if (oldsize >= total_size) 
 	{
@@ -314,10 +949,26 @@ mm_realloc(void *ptr, size_t size)
 	}
 	
 		
+	/*
+	 * A block at the end of the heap, or followed only by a wilderness
+	 * too small to merge with, grows in place into an extension of the
+	 * heap.  grow_heap adds the extension right after "ptr" and merges
+	 * it with the wilderness, so the block after "ptr" becomes a free
+	 * block of at least total_size - oldsize + 2 * DSIZE bytes and the
+	 * merge below succeeds.  If the heap can't grow, the block is
+	 * copied to a new one instead.
+	 */
 	size_t next_blkp_size = (size_t)GET_SIZE(HDRP(NEXT_BLKP(ptr)));
-	if((size_t)GET_ALLOC(HDRP(NEXT_BLKP(ptr)))==0   &&   next_blkp_size + oldsize - total_size > DSIZE)
+	if (total_size > oldsize && (next_blkp_size == 0 ||
+	    (!GET_ALLOC(HDRP(NEXT_BLKP(ptr))) &&
+	    GET_SIZE(HDRP(NEXT_BLKP(NEXT_BLKP(ptr)))) == 0 &&
+	    next_blkp_size + oldsize <= total_size + DSIZE)) &&
+	    grow_heap(total_size - oldsize + 2 * DSIZE) != NULL)
+		next_blkp_size = (size_t)GET_SIZE(HDRP(NEXT_BLKP(ptr)));
+	if((size_t)GET_ALLOC(HDRP(NEXT_BLKP(ptr)))==0   &&   next_blkp_size + oldsize > total_size + DSIZE)
 	{
 		Delete_Fb(NEXT_BLKP(ptr),next_blkp_size);//Deletes the block  from the explicictly maintained free list
+		CHECK_MERGED(NEXT_BLKP(ptr), ptr);
 		PUT(HDRP(ptr), PACK(total_size, 1));//packs the size of the block and the allocation(1) status in the header
 		PUT(FTRP(ptr), PACK(total_size, 1));//packs the size of the block and the allocation(1) status in the footer
 		void *bp = NEXT_BLKP(ptr);
@@ -329,6 +980,7 @@ mm_realloc(void *ptr, size_t size)
 		//Adds the block to the explicictly maintained free list checkheap(1);
 		return ptr;
 	}
+
 	
 	newptr = mm_malloc(size);
 
@@ -348,231 +1000,1914 @@ mm_realloc(void *ptr, size_t size)
 	return (newptr);
 }
 
-/*
- * The following routines are internal helper routines.
- */
-
 /*
  * Requires:
- *   "bp" is the address of a newly freed block.
+ *   "alignment" is a power of two.
  *
  * Effects:
- *   Perform boundary tag coalescing.  Returns the address of the coalesced
- *   block.
+ *   Allocate a block with at least "size" bytes of payload whose address
+ *   is a multiple of "alignment", unless "size" is zero.  Returns the
+ *   address of this block if the allocation was successful and NULL
+ *   otherwise.  The block can be passed to mm_free and mm_realloc.
  */
-static void *
-coalesce(void *ptr) 
+void *
+mm_memalign(size_t alignment, size_t size)
 {
-	bool prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(ptr)));	// Get allocated status of the previous block
-	bool next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(ptr)));	// Get the allocated status of the next block
-	size_t size = GET_SIZE(HDRP(ptr));			// Size of the present block
-
+	size_t asize, csize, lead;
+	char *bp, *abp;
 
-		
-	// Since previous and next are free, it coalesces the three of them and return the pointer to the previous block
-	if (prev_alloc && next_alloc) {                 /* Case 1 */
-		Add_Fb(ptr,size);// Adds free block to the explicitly maintained free list
-		return ptr;
-	}
-	
-	 else if (prev_alloc && !next_alloc) {         /* Case 2 */
-		Delete_Fb(NEXT_BLKP(ptr),GET_SIZE(HDRP(NEXT_BLKP(ptr))));
-		// Deletes the previously embedded block from the explicictly maintained free list
-		size += GET_SIZE(HDRP(NEXT_BLKP(ptr)));//calulation of the total new size to be allocated at the new pointer location
-		PUT(HDRP(ptr), PACK(size, 0));// packs the size of the block and the allocation(0) status in the header
-		PUT(FTRP(ptr), PACK(size, 0));// packs the size of the block and the allocation(0) status in the footer
-		Add_Fb(ptr,size);// Adds free block to the explicitly maintained free list	
+	if (alignment > MM_REQUEST_MAX || size > MM_REQUEST_MAX - alignment) {
+		errno = ENOMEM;
+		return (NULL);
 	}
-	
-	 else if (!prev_alloc && next_alloc) {         /* Case 3 */
-		Delete_Fb(PREV_BLKP(ptr),GET_SIZE(HDRP(PREV_BLKP(ptr))));
-		size += GET_SIZE(HDRP(PREV_BLKP(ptr)));//calulation of the total new size to be allocated at the new pointer location
-		PUT(FTRP(ptr), PACK(size, 0));
-		PUT(HDRP(PREV_BLKP(ptr)), PACK(size, 0));
-		ptr = PREV_BLKP(ptr);
-		Add_Fb(ptr,size);// Adds free block to the explicitly maintained free list
-	
+#ifdef MM_GUARD
+	return (size == 0 ? NULL : guard_alloc(size, MAX(alignment, DSIZE)));
+#endif
+#ifdef MM_BUDDY
+	return (size == 0 ? NULL : buddy_alloc(size, MAX(alignment, DSIZE)));
+#endif
+	if (alignment <= DSIZE)
+		return (mm_malloc(size));
+	if (size == 0)
+		return (NULL);
+
+	/* Over-allocate so that an aligned payload, preceded by either
+	 * nothing or a free block of at least the minimum size, fits. */
+	if ((bp = mm_malloc(size + alignment + 2 * DSIZE)) == NULL)
+		return (NULL);
+	csize = GET_SIZE(HDRP(bp));
+	abp = (char *)(((uintptr_t)bp + alignment - 1) & ~(alignment - 1));
+	if (abp != bp && (size_t)(abp - bp) < 2 * DSIZE)
+		abp += alignment;
+
+	/* Give the leading gap back as a free block. */
+	if (abp != bp) {
+		PROF_MOVE(bp, abp);
+		lead = abp - bp;
+		PUT(HDRP(bp), PACK(lead, 0));
+		PUT(FTRP(bp), PACK(lead, 0));
+		PUT(HDRP(abp), PACK(csize - lead, 1));
+		PUT(FTRP(abp), PACK(csize - lead, 1));
+		coalesce(bp);
+		csize -= lead;
 	}
-	
-	 else {                                        /* Case 4 */
-		Delete_Fb(PREV_BLKP(ptr),GET_SIZE(HDRP(PREV_BLKP(ptr))));
-		// Deletes the Prev free block from the explicitly maintained list
-		Delete_Fb(NEXT_BLKP(ptr),GET_SIZE(HDRP(NEXT_BLKP(ptr))));
-		//Deletes the Next free block from the explicitly maintained list
-		size += GET_SIZE(HDRP(PREV_BLKP(ptr))) + 
-		    GET_SIZE(HDRP(NEXT_BLKP(ptr)));	 //calulation of the total new size to be allocated at the new pointer location
-		PUT(HDRP(PREV_BLKP(ptr)), PACK(size, 0));// packs the size of the block and the allocation(0) status in the header
-		PUT(FTRP(NEXT_BLKP(ptr)), PACK(size, 0));// packs the size of the block and the allocation(0) status in the footer
-		ptr = PREV_BLKP(ptr);
-		Add_Fb(ptr,size);		// Adds free block to the explicitly maintained free list
+
+	/* Give the trailing excess back as a free block. */
+	asize = ASIZE(size);
+	if (csize - asize >= 2 * DSIZE) {
+		PUT(HDRP(abp), PACK(asize, 1));
+		PUT(FTRP(abp), PACK(asize, 1));
+		bp = NEXT_BLKP(abp);
+		PUT(HDRP(bp), PACK(csize - asize, 0));
+		PUT(FTRP(bp), PACK(csize - asize, 0));
+		coalesce(bp);
 	}
-	return (ptr);
+	return (abp);
 }
 
-/* 
+/*
  * Requires:
- *   None.
+ *   "flags" is 0 or MM_NOSHARE.
  *
  * Effects:
- *   Extend the heap with a free block and return that block's address.
+ *   Allocate a block like mm_malloc.  With MM_NOSHARE, a block of
+ *   MM_LINE bytes or more starts on a cache line boundary and is padded
+ *   to a whole number of lines, so it shares no line with any other
+ *   block, and a smaller block is aligned to its size rounded up to a
+ *   power of two, so it never straddles two lines.  Returns the address
+ *   of the block, which can be passed to mm_free and mm_realloc, or
+ *   NULL.
  */
-static void *	
-extend_heap(size_t words) 
+void *
+mm_malloc_flags(size_t size, int flags)
 {
-	void *bp;
-	size_t size;				// Allocate an even number of words to maintain alignment. 
-
-	/* Allocate an even number of words to maintain alignment. */
-	size = (words % 2) ? (words + 1) * WSIZE : words * WSIZE;
-	if ((bp = mem_sbrk(size)) == (void *)-1)  
-		return (NULL);
+	size_t align;
 
-	/* Initialize free block header/footer and the epilogue header. */
-	PUT(HDRP(bp), PACK(size, 0));         /* Free block header */
-	PUT(FTRP(bp), PACK(size, 0));         /* Free block footer */
-	PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); /* New epilogue header */
+	if (!(flags & MM_NOSHARE) || size == 0 || size > MM_REQUEST_MAX)
+		return (mm_malloc(size));
+	if (size >= MM_LINE) {
+		size = (size + MM_LINE - 1) & ~(size_t)(MM_LINE - 1);
+		return (mm_memalign(MM_LINE, size));
+	}
+	for (align = DSIZE; align < size; align *= 2)
+		;
+	return (mm_memalign(align, size));
+}
 
-	/* Coalesce if the previous block was free. */
-	return (coalesce(bp));
+/*
+ * Requires:
+ *   "ptr" is the address of an allocated block.
+ *
+ * Effects:
+ *   Returns the number of payload bytes usable in the block "ptr", which
+ *   is at least the size that was requested for it.
+ */
+size_t
+mm_usable_size(void *ptr)
+{
+#ifdef MM_GUARD
+	return (((struct guard_hdr *)ptr - 1)->size);
+#endif
+#ifdef MM_BUDDY
+	return ((size_t)DSIZE << buddy_order[BUDDY_UNIT(ptr)]);
+#endif
+	return (GET_SIZE(HDRP(ptr)) - DSIZE);
 }
 
 /*
  * Requires:
- *   None.
+ *   "p" points to a struct mm_params.
  *
  * Effects:
- *   Find a fit for a block with "asize" bytes.  Returns that block's address
- *   or NULL if no suitable block was found. 
+ *   Use the parameters "p" from the next mm_init on.  Returns 0 if
+ *   they are valid and -1, changing nothing, if they aren't: the chunk
+ *   size and split threshold must be multiples of DSIZE, at least
+ *   2 * DSIZE, nbins must leave at least one bin above the exact
+ *   small bins, and place_high must be a multiple of DSIZE (0 turns
+ *   high-end placement off).  The guard page and buddy modes ignore
+ *   them.
  */
-static void *
-find_fit(size_t asize)
+int
+mm_set_params(const struct mm_params *p)
 {
-	void *bp;
-	char *p=htp;
-	int num=asize/6000; // Hash Index
-	if(num>=50)
-		num=49;
-	char *k;
-	int new_num;
-	for(new_num=num;new_num<50;new_num++){
-		k=p+DSIZE*new_num; // directs to the particular list where the ree block has to be inserted
 
-		/* Search for the first fit. */
-	for (bp = NextFreeBlock(k); (bp != 0)&&(k<p+DSIZE*50); bp = NextFreeBlock(bp)) 
-	//This is traversing the whole explicictly maintained free list to get the exact or nearly exact fit for allocation
-			{
-				if (asize <= GET_SIZE(HDRP(bp)))// checks the size with the required size.
-					   return bp;
-    			}
-  		}
-	/* No fit was found. */
-	return (NULL);
+	if (p->chunksize < 2 * DSIZE || p->chunksize % DSIZE != 0 ||
+	    p->chunksize > MM_CHUNKSIZE_MAX ||
+	    p->split_min < 2 * DSIZE || p->split_min % DSIZE != 0 ||
+	    p->nbins <= MM_SMALL_BINS || p->nbins > MM_NBINS ||
+	    p->place_high % DSIZE != 0)
+		return (-1);
+	next_params = *p;
+	return (0);
 }
 
-/* 
+/*
  * Requires:
- *   "bp" is the address of a free block that is at least "asize" bytes.
+ *   "p" points to a struct mm_params.
  *
  * Effects:
- *   Place a block of "asize" bytes at the start of the free block "bp" and
- *   split that block if the remainder would be at least the minimum block
- *   size. 
+ *   Fill in "p" with the parameters the next mm_init will use.
  */
-static void
-place(void *bp, size_t asize)
+void
+mm_get_params(struct mm_params *p)
 {
-	size_t csize = GET_SIZE(HDRP(bp));   		//computes the size of the block
 
-	if ((csize - asize) >= (2 * DSIZE)) { 
-		Delete_Fb(bp,csize);
-		PUT(HDRP(bp), PACK(asize, 1));//packs the size of the block and the allocation(1) status in the footer
-		PUT(FTRP(bp), PACK(asize, 1));//packs the size of the block and the allocation(1) status in the header
-		bp = NEXT_BLKP(bp);	      //gets the next block pointer
-		PUT(HDRP(bp), PACK(csize - asize, 0));	//packs the size of the block and the allocation(0) status in the footer
-		PUT(FTRP(bp), PACK(csize - asize, 0));  //packs the size of the block and the allocation(0) status in the header
-		Add_Fb(bp,csize-asize);//Adds the newly created block to the explicitly maintained free list
-	} else {
-		PUT(HDRP(bp), PACK(csize, 1));//packs the size of the block and the allocation(1) status in the header
-		PUT(FTRP(bp), PACK(csize, 1));//packs the size of the block and the allocation(1) status in the footer
-		Delete_Fb(bp,csize);//Deletes the block  from the explicictly maintained free list
+	*p = next_params;
+}
+
+/*
+ * Requires:
+ *   "s" is a string of comma-separated name=value pairs, and "p" points
+ *   to a struct mm_params.
+ *
+ * Effects:
+ *   Set the fields of "p" named in "s" (chunksize, split_min, nbins,
+ *   place_high).
+ *   Returns 0 on success and -1, leaving "p" partly updated, on an
+ *   unknown name or a value that isn't a number.  The values are
+ *   checked by mm_set_params, not here.
+ */
+int
+mm_parse_params(const char *s, struct mm_params *p)
+{
+	char *end;
+	unsigned long v;
+	size_t n;
+
+	while (*s != '\0') {
+		n = strcspn(s, "=");
+		if (s[n] != '=')
+			return (-1);
+		v = strtoul(s + n + 1, &end, 0);
+		if (end == s + n + 1 || (*end != ',' && *end != '\0'))
+			return (-1);
+		if (n == 9 && strncmp(s, "chunksize", n) == 0)
+			p->chunksize = v;
+		else if (n == 9 && strncmp(s, "split_min", n) == 0)
+			p->split_min = v;
+		else if (n == 5 && strncmp(s, "nbins", n) == 0)
+			p->nbins = (int)v;
+		else if (n == 10 && strncmp(s, "place_high", n) == 0)
+			p->place_high = v;
+		else
+			return (-1);
+		s = (*end == ',') ? end + 1 : end;
 	}
+	return (0);
 }
 
-/* 
- * The remaining routines are heap consistency checker routines. 
+/*
+ * Requires:
+ *   "st" points to a struct mm_stats.
+ *
+ * Effects:
+ *   Fill in "st" with the current heap statistics, summed over all
+ *   arenas in NUMA mode.
  */
+void
+mm_stats(struct mm_stats *st)
+{
+#ifdef MM_NUMA
+	struct mm_stats one;
+	int a, cur = cur_arena, i;
+
+	memset(st, 0, sizeof(*st));
+	for (a = 0; a < numa_narenas; a++) {
+		NUMA_SWITCH(a);
+		arena_stats(&one);
+		st->heap_size += one.heap_size;
+		st->peak_heap_size += one.peak_heap_size;
+		st->alloc_bytes += one.alloc_bytes;
+		st->alloc_blocks += one.alloc_blocks;
+		st->free_bytes += one.free_bytes;
+		st->free_blocks += one.free_blocks;
+		st->largest_free = MAX(st->largest_free, one.largest_free);
+		for (i = 0; i < MM_NBINS; i++) {
+			st->bin_free_bytes[i] += one.bin_free_bytes[i];
+			st->bin_free_blocks[i] += one.bin_free_blocks[i];
+		}
+	}
+	NUMA_SWITCH(cur);
+	if (st->free_bytes > 0)
+		st->ext_frag = 1.0 - (double)st->largest_free / st->free_bytes;
+#else
+	arena_stats(st);
+#endif
+}
 
 /*
  * Requires:
- *   "bp" is the address of a block.
+ *   "st" points to a struct mm_stats.
  *
  * Effects:
- *   Perform a minimal check on the block "bp".
+ *   Fill in "st" with the statistics of the current heap.  The counters
+ *   are kept up to date by Add_Fb, Delete_Fb, mm_malloc and mm_free, so
+ *   only the largest free block needs a search, and that search is
+ *   limited to the highest non-empty bin.
  */
 static void
-checkblock(void *bp) 
+arena_stats(struct mm_stats *st)
 {
+	void *bp;
+	int i;
+
+	memset(st, 0, sizeof(*st));
+	st->heap_size = mem_heapsize();
+	st->peak_heap_size = MAX(peak_heap, st->heap_size);
+	st->alloc_blocks = alloc_blocks;
+#ifdef MM_GUARD
+	return;
+#endif
+#ifdef MM_BUDDY
+	buddy_stats(st);
+	return;
+#endif
+	for (i = 0; i < MM_NBINS; i++) {
+		st->bin_free_bytes[i] = bin_bytes[i];
+		st->bin_free_blocks[i] = bin_blocks[i];
+		st->free_bytes += bin_bytes[i];
+		st->free_blocks += bin_blocks[i];
+	}
 
-	if ((uintptr_t)bp % DSIZE)
-		printf("Error: %p is not doubleword aligned\n", bp);
-	if (GET(HDRP(bp)) != GET(FTRP(bp))){
-		size_t h=GET(HDRP(bp));
-		size_t f=GET(FTRP(bp));
-		size_t preh=GET(HDRP(PREV_BLKP(bp)));
-		printf("Error: header %zu does not match footer %zu %p and previous block %zu\n,",h,f,bp,preh);
-		}
+	/* Everything that isn't free or bookkeeping is allocated. */
+	st->alloc_bytes = (char *)mem_heap_hi() + 1 - heap_listp - DSIZE -
+	    st->free_bytes;
+
+#ifdef MM_TLSF
+	/* The largest block is on the highest non-empty list. */
+	i = fl_map == 0 ? -1 : MM_LOG2(fl_map) * TLSF_SL +
+	    MM_LOG2(sl_map[MM_LOG2(fl_map)]);
+#else
+	for (i = MM_NBINS - 1; i >= 0 && bin_blocks[i] == 0; i--)
+		;
+#endif
+	if (i >= 0) {
+		for (bp = NextFreeBlock(htp + DSIZE * i); bp != 0;
+		    bp = NextFreeBlock(bp))
+			st->largest_free = MAX(st->largest_free,
+			    GET_SIZE(HDRP(bp)));
+	}
+	if (st->free_bytes > 0)
+		st->ext_frag = 1.0 - (double)st->largest_free / st->free_bytes;
 }
 
-/* 
+/*
  * Requires:
  *   None.
  *
  * Effects:
- *   Perform a minimal check of the heap for consistency. 
+ *   Make the calling thread allocate from the arena of NUMA node
+ *   "node", or from that of the CPU it is running on if "node" is
+ *   negative (the default).  Does nothing unless mm.c is built with
+ *   -DMM_NUMA.
  */
 void
-checkheap(bool verbose) 
+mm_numa_set_node(int node)
 {
-	void *bp;
+#ifdef MM_NUMA
+	numa_node = node;
+#else
+	(void)node;
+#endif
+}
 
-	if (verbose)
-		printf("Heap (%p):\n", heap_listp);
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Returns the number of arenas (NUMA nodes), which is 1 unless mm.c
+ *   is built with -DMM_NUMA, and 0 before the first mm_init.
+ */
+int
+mm_numa_nodes(void)
+{
+#ifdef MM_NUMA
+	return (numa_narenas);
+#else
+	return (1);
+#endif
+}
 
-	if (GET_SIZE(HDRP(heap_listp)) != DSIZE ||
-	    !GET_ALLOC(HDRP(heap_listp)))
-		printf("Bad prologue header\n");
-	checkblock(heap_listp);
+#ifdef MM_NUMA
+/*
+ * The following routines implement the NUMA arenas.
+ */
 
-	for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp)) {
-		if (verbose)
-			printblock(bp);
-		checkblock(bp);
-	}
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Returns the arena for the calling thread: the one it chose with
+ *   mm_numa_set_node, or else that of the node of its current CPU.
+ */
+static int
+numa_local(void)
+{
 
-	if (verbose)
-		printblock(bp);
-	if (GET_SIZE(HDRP(bp)) != 0 || !GET_ALLOC(HDRP(bp)))
-		printf("Bad epilogue header\n");
+	if (numa_node >= 0 && numa_node < numa_narenas)
+		return (numa_node);
+	return (mem_cpu_node(sched_getcpu()) % numa_narenas);
 }
 
 /*
  * Requires:
- *   "bp" is the address of a block.
+ *   "a" is an arena number.
  *
  * Effects:
- *   Print the block "bp".
+ *   Save the current arena's state and make arena "a" and its memlib
+ *   region current.
  */
 static void
-printblock(void *bp) 
+numa_switch(int a)
 {
-	bool halloc, falloc;
-	size_t hsize, fsize;
+	struct arena *ar = &arenas[cur_arena];
+
+	ar->heap_listp = heap_listp;
+	ar->htp = htp;
+	memcpy(ar->bin_bytes, bin_bytes, sizeof(bin_bytes));
+	memcpy(ar->bin_blocks, bin_blocks, sizeof(bin_blocks));
+	ar->alloc_blocks = alloc_blocks;
+	ar->peak_heap = peak_heap;
+	ar->grow = grow;
+	ar->nmallocs = nmallocs;
+	ar->last_grow = last_grow;
+	ar->bin_map = bin_map;
+	memcpy(ar->fits, fits, sizeof(fits));
+#ifdef MM_TLSF
+	ar->fl_map = fl_map;
+	memcpy(ar->sl_map, sl_map, sizeof(sl_map));
+#endif
+#ifdef MM_CHECK
+	ar->check_cursor = check_cursor;
+#endif
+
+	ar = &arenas[a];
+	heap_listp = ar->heap_listp;
+	htp = ar->htp;
+	memcpy(bin_bytes, ar->bin_bytes, sizeof(bin_bytes));
+	memcpy(bin_blocks, ar->bin_blocks, sizeof(bin_blocks));
+	alloc_blocks = ar->alloc_blocks;
+	peak_heap = ar->peak_heap;
+	grow = ar->grow;
+	nmallocs = ar->nmallocs;
+	last_grow = ar->last_grow;
+	bin_map = ar->bin_map;
+	memcpy(fits, ar->fits, sizeof(fits));
+#ifdef MM_TLSF
+	fl_map = ar->fl_map;
+	memcpy(sl_map, ar->sl_map, sizeof(sl_map));
+#endif
+#ifdef MM_CHECK
+	check_cursor = ar->check_cursor;
+#endif
+	mem_set_node(a);
+	cur_arena = a;
+}
+#endif
 
-	checkheap(false);
-	hsize = GET_SIZE(HDRP(bp));
-	halloc = GET_ALLOC(HDRP(bp));  
-	fsize = GET_SIZE(FTRP(bp));
-	falloc = GET_ALLOC(FTRP(bp));  
+#ifdef MM_GUARD
+/*
+ * The following routines implement the guard page mode.
+ */
+
+/*
+ * Requires:
+ *   "size" is positive and "alignment" is a power of two no smaller
+ *   than DSIZE.
+ *
+ * Effects:
+ *   Allocate a block of "size" bytes at a multiple of "alignment",
+ *   ending as close below a guard page as the alignment allows.
+ *   Returns the block's address or NULL if the heap is exhausted.
+ */
+static void *
+guard_alloc(size_t size, size_t alignment)
+{
+	struct guard_run *run, **prevp, *rest;
+	struct guard_hdr *hdr;
+	size_t npages;
+	char *start, *guard, *bp;
+
+	/* The data pages, then the guard page. */
+	npages = (size + alignment + sizeof(struct guard_hdr) +
+	    guard_pagesize - 1) / guard_pagesize + 1;
+
+	/* Reuse the first big enough run that left quarantine. */
+	for (prevp = &guard_runs; (run = *prevp) != NULL; prevp = &run->next)
+		if (run->npages >= npages)
+			break;
+	if (run != NULL) {
+		*prevp = run->next;
+		start = (char *)run;
+		if (run->npages > npages) {
+			rest = (struct guard_run *)(start + npages * guard_pagesize);
+			rest->npages = run->npages - npages;
+			rest->next = guard_runs;
+			guard_runs = rest;
+		}
+	} else {
+		if ((start = mem_sbrk(npages * guard_pagesize)) == (void *)-1)
+			return (NULL);
+		peak_heap = MAX(peak_heap, mem_heapsize());
+	}
+
+	guard = start + (npages - 1) * guard_pagesize;
+	bp = (char *)((uintptr_t)(guard - size) & ~(alignment - 1));
+	hdr = (struct guard_hdr *)bp - 1;
+	hdr->npages = npages;
+	hdr->size = size;
+	memset(bp + size, GUARD_FILL, guard - (bp + size));
+	if (mem_protect(guard, guard_pagesize, PROT_NONE) < 0)
+		return (NULL);
+	alloc_blocks++;
+	return (bp);
+}
+
+/*
+ * Requires:
+ *   "bp" is the address of a block from guard_alloc.
+ *
+ * Effects:
+ *   Check the padding after the block, make the block's pages
+ *   inaccessible and quarantine them.  The oldest quarantined run is
+ *   released for reuse once the quarantine is full.
+ */
+static void
+guard_free(void *bp)
+{
+	struct guard_hdr *hdr = (struct guard_hdr *)bp - 1;
+	struct guard_run *run;
+	char *end, *guard, *start;
+	size_t npages;
+	int slot;
+
+	/* A block freed twice faults here, since its pages are protected. */
+	npages = hdr->npages;
+	end = (char *)bp + hdr->size;
+	guard = (char *)(((uintptr_t)end + guard_pagesize - 1) &
+	    ~(guard_pagesize - 1));
+	for (; end < guard; end++) {
+		if (*(unsigned char *)end != GUARD_FILL) {
+			fprintf(stderr, "mm: write past the end of block %p\n", bp);
+			abort();
+		}
+	}
+	start = guard - (npages - 1) * guard_pagesize;
+	mem_protect(start, npages * guard_pagesize, PROT_NONE);
+	alloc_blocks--;
+
+	if (guard_fifo_count == GUARD_QUARANTINE) {
+		run = (struct guard_run *)guard_fifo[guard_fifo_head];
+		mem_protect(run, guard_fifo_npages[guard_fifo_head] *
+		    guard_pagesize, PROT_READ | PROT_WRITE);
+		run->npages = guard_fifo_npages[guard_fifo_head];
+		run->next = guard_runs;
+		guard_runs = run;
+		guard_fifo_head = (guard_fifo_head + 1) % GUARD_QUARANTINE;
+		guard_fifo_count--;
+	}
+	slot = (guard_fifo_head + guard_fifo_count) % GUARD_QUARANTINE;
+	guard_fifo[slot] = start;
+	guard_fifo_npages[slot] = npages;
+	guard_fifo_count++;
+}
+
+/*
+ * Requires:
+ *   "bp" is the address of a block from guard_alloc and "size" is
+ *   positive.
+ *
+ * Effects:
+ *   Move the block to a new run of "size" bytes, which also checks the
+ *   old block and puts it in quarantine.
+ */
+static void *
+guard_realloc(void *bp, size_t size)
+{
+	size_t oldsize = ((struct guard_hdr *)bp - 1)->size;
+	void *newbp;
+
+	if ((newbp = guard_alloc(size, DSIZE)) == NULL)
+		return (NULL);
+	memcpy(newbp, bp, MIN(oldsize, size));
+	guard_free(bp);
+	return (newbp);
+}
+#endif
+
+#ifdef MM_BUDDY
+/*
+ * The following routines implement the buddy allocator mode.  Blocks
+ * are named by their offset from buddy_base in doublewords ("units").
+ */
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Start an empty buddy heap at the current break.  Returns 0.
+ */
+static int
+buddy_init(void)
+{
+	int k;
+
+	/* Forget the free blocks of the last heap. */
+	if (buddy_isfree != NULL)
+		memset(buddy_isfree, 0, (buddy_top + 63) / 64 * sizeof(uint64_t));
+	for (k = 0; k < BUDDY_ORDERS; k++)
+		buddy_lists[k].next = buddy_lists[k].prev = &buddy_lists[k];
+	buddy_map = 0;
+	buddy_base = mem_sbrk(0);
+	buddy_top = 0;
+	alloc_blocks = 0;
+	peak_heap = 0;
+	return (0);
+}
+
+/*
+ * Requires:
+ *   "size" is positive.
+ *
+ * Effects:
+ *   Returns the order of the smallest block that holds "size" bytes.
+ */
+static int
+buddy_order_of(size_t size)
+{
+	size_t units = (size + DSIZE - 1) / DSIZE;
+
+	return (units <= 1 ? 0 : MM_LOG2(units - 1) + 1);
+}
+
+/*
+ * Requires:
+ *   "size" is positive and "alignment" is a power of two no smaller
+ *   than DSIZE.
+ *
+ * Effects:
+ *   Allocate a block of at least "size" bytes at a multiple of
+ *   "alignment", splitting the smallest large enough free block.
+ *   Returns the block's address or NULL if the heap is exhausted or
+ *   the heap's start isn't aligned that far.
+ */
+static void *
+buddy_alloc(size_t size, size_t alignment)
+{
+	uint64_t map;
+	size_t u;
+	int j, k;
+
+	k = buddy_order_of(MAX(size, alignment));
+	if (k >= BUDDY_ORDERS || (uintptr_t)buddy_base % alignment != 0)
+		return (NULL);
+	if ((map = buddy_map >> k << k) == 0) {
+		if (!buddy_extend(k))
+			return (NULL);
+		map = buddy_map >> k << k;
+	}
+	j = __builtin_ctzll(map);
+	u = BUDDY_UNIT(buddy_lists[j].next);
+	buddy_unlink(u, j);
+
+	/* Free the upper half until the block is of order k. */
+	while (j > k) {
+		j--;
+		buddy_push(u + ((size_t)1 << j), j);
+	}
+	buddy_order[u] = k;
+	alloc_blocks++;
+	return (BUDDY_BLOCK(u));
+}
+
+/*
+ * Requires:
+ *   "bp" is the address of a block from buddy_alloc.
+ *
+ * Effects:
+ *   Free the block, merging it with its buddy while that is free.
+ *   A block that is already free is reported and aborts.
+ */
+static void
+buddy_free(void *bp)
+{
+	size_t u = BUDDY_UNIT(bp);
+
+	if (BUDDY_ISFREE(u)) {
+		fprintf(stderr, "mm: double free of block %p\n", bp);
+		abort();
+	}
+	alloc_blocks--;
+	buddy_release(u, buddy_order[u]);
+}
+
+/*
+ * Requires:
+ *   "bp" is the address of a block from buddy_alloc and "size" is
+ *   positive.
+ *
+ * Effects:
+ *   Resize the block in place if it shrinks, or if it grows and is the
+ *   lower half of every larger block up to the new order, with free
+ *   upper halves.  Otherwise move it to a new block.  Returns the
+ *   block's address or NULL, leaving the block untouched, if the heap
+ *   is exhausted.
+ */
+static void *
+buddy_realloc(void *bp, size_t size)
+{
+	size_t u = BUDDY_UNIT(bp), b;
+	int j, k = buddy_order[u], need = buddy_order_of(size);
+	void *newbp;
+
+	if (need >= BUDDY_ORDERS)
+		return (NULL);
+	if (need <= k) {
+		while (k > need) {
+			k--;
+			buddy_push(u + ((size_t)1 << k), k);
+		}
+		buddy_order[u] = need;
+		return (bp);
+	}
+	for (j = k; j < need; j++) {
+		b = u + ((size_t)1 << j);
+		if ((u >> j) & 1 || b + ((size_t)1 << j) > buddy_top ||
+		    !BUDDY_ISFREE(b) || buddy_order[b] != j)
+			break;
+	}
+	if (j == need) {
+		for (j = k; j < need; j++)
+			buddy_unlink(u + ((size_t)1 << j), j);
+		buddy_order[u] = need;
+		return (bp);
+	}
+
+	if ((newbp = buddy_alloc(size, DSIZE)) == NULL)
+		return (NULL);
+	memcpy(newbp, bp, MIN((size_t)DSIZE << k, size));
+	buddy_free(bp);
+	return (newbp);
+}
+
+/*
+ * Requires:
+ *   "k" is less than BUDDY_ORDERS.
+ *
+ * Effects:
+ *   Extend the heap with a free block of order "k", aligned to its
+ *   size, freeing the gap below it, and grow the side tables to cover
+ *   it.  Returns true if successful and false otherwise.
+ */
+static bool
+buddy_extend(int k)
+{
+	size_t n = (size_t)1 << k, start, cap, u;
+	uint64_t *isfree;
+	char *tables;
+	int j;
+
+	start = (buddy_top + n - 1) & ~(n - 1);
+	if (start + n > buddy_cap) {
+		for (cap = MAX(buddy_cap, BUDDY_MIN); cap < start + n; cap *= 2)
+			;
+		tables = mmap(NULL, cap / 8 + cap, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (tables == MAP_FAILED)
+			return (false);
+		isfree = (uint64_t *)tables;
+		if (buddy_cap > 0) {
+			memcpy(isfree, buddy_isfree, buddy_cap / 8);
+			memcpy(tables + cap / 8, buddy_order, buddy_top);
+			munmap(buddy_isfree, buddy_cap / 8 + buddy_cap);
+		}
+		buddy_isfree = isfree;
+		buddy_order = (unsigned char *)tables + cap / 8;
+		buddy_cap = cap;
+	}
+	if (mem_sbrk((start + n - buddy_top) * DSIZE) == (void *)-1)
+		return (false);
+	peak_heap = MAX(peak_heap, mem_heapsize());
+
+	/* Free the gap in the largest blocks that are aligned there. */
+	while (buddy_top < start) {
+		u = buddy_top;
+		j = __builtin_ctzll(u);
+		buddy_top += (size_t)1 << j;
+		buddy_release(u, j);
+	}
+	buddy_top = start + n;
+	buddy_release(start, k);
+	return (true);
+}
+
+/*
+ * Requires:
+ *   The block at "u" is of order "k" and not on a free list.
+ *
+ * Effects:
+ *   Mark the block free and put it at the head of list "k".
+ */
+static void
+buddy_push(size_t u, int k)
+{
+	struct buddy_link *l = (struct buddy_link *)BUDDY_BLOCK(u);
+	struct buddy_link *head = &buddy_lists[k];
+
+	l->next = head->next;
+	l->prev = head;
+	head->next->prev = l;
+	head->next = l;
+	buddy_order[u] = k;
+	buddy_isfree[u / 64] |= (uint64_t)1 << (u % 64);
+	buddy_map |= (uint64_t)1 << k;
+}
+
+/*
+ * Requires:
+ *   The block at "u" is on free list "k".
+ *
+ * Effects:
+ *   Take the block off the list and mark it allocated.
+ */
+static void
+buddy_unlink(size_t u, int k)
+{
+	struct buddy_link *l = (struct buddy_link *)BUDDY_BLOCK(u);
+
+	l->prev->next = l->next;
+	l->next->prev = l->prev;
+	buddy_isfree[u / 64] &= ~((uint64_t)1 << (u % 64));
+	if (buddy_lists[k].next == &buddy_lists[k])
+		buddy_map &= ~((uint64_t)1 << k);
+}
+
+/*
+ * Requires:
+ *   The block at "u" is of order "k" and not on a free list.
+ *
+ * Effects:
+ *   Free the block, merged with its buddy, and the merged block with
+ *   its buddy, for as long as the buddy is a free block of the same
+ *   order.
+ */
+static void
+buddy_release(size_t u, int k)
+{
+	size_t b;
+
+	for (; k < BUDDY_ORDERS - 1; k++) {
+		b = u ^ ((size_t)1 << k);
+		if (b + ((size_t)1 << k) > buddy_top || !BUDDY_ISFREE(b) ||
+		    buddy_order[b] != k)
+			break;
+		buddy_unlink(b, k);
+		u &= ~((size_t)1 << k);
+	}
+	buddy_push(u, k);
+}
+
+/*
+ * Requires:
+ *   "st" has been zeroed and filled in by arena_stats up to the
+ *   allocated blocks.
+ *
+ * Effects:
+ *   Fill in the rest of "st" by walking the free lists.
+ */
+static void
+buddy_stats(struct mm_stats *st)
+{
+	struct buddy_link *l;
+	size_t size;
+	int k;
+
+	for (k = 0; k < BUDDY_ORDERS; k++) {
+		size = (size_t)DSIZE << k;
+		for (l = buddy_lists[k].next; l != &buddy_lists[k];
+		    l = l->next) {
+			st->bin_free_bytes[BIN(size)] += size;
+			st->bin_free_blocks[BIN(size)]++;
+			st->free_bytes += size;
+			st->free_blocks++;
+		}
+	}
+	st->alloc_bytes = buddy_top * DSIZE - st->free_bytes;
+	if (buddy_map != 0)
+		st->largest_free = (size_t)DSIZE << MM_LOG2(buddy_map);
+	if (st->free_bytes > 0)
+		st->ext_frag = 1.0 - (double)st->largest_free / st->free_bytes;
+}
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Check the buddy heap: every block is aligned to its size, no two
+ *   free buddies are left unmerged, the free bits mark exactly the
+ *   free blocks, and each free list holds exactly the free blocks of
+ *   its order, linked in both directions.  Prints each problem (and
+ *   every block if "verbose") and returns the number of problems
+ *   found.
+ */
+static int
+buddy_check(int verbose)
+{
+	struct buddy_link *l;
+	size_t u, b, n, nfree = 0, nalloc = 0, nbits = 0, nlisted = 0;
+	int errors = 0, k;
+
+	if (verbose)
+		printf("Heap (%p):\n", buddy_base);
+	if (buddy_base + buddy_top * DSIZE != (char *)mem_heap_hi() + 1) {
+		printf("Error: the heap ends at %p, not %p\n",
+		    (char *)mem_heap_hi() + 1, buddy_base + buddy_top * DSIZE);
+		errors++;
+	}
+
+	/* Every block, in address order */
+	for (u = 0; u < buddy_top; u += n) {
+		k = buddy_order[u];
+		if (k >= BUDDY_ORDERS || (u & (((size_t)1 << k) - 1)) != 0 ||
+		    u + ((size_t)1 << k) > buddy_top) {
+			printf("Error: block %p has bad order %d\n",
+			    BUDDY_BLOCK(u), k);
+			return (errors + 1);	/* Can't go on. */
+		}
+		n = (size_t)1 << k;
+		if (verbose)
+			printf("%p: order %d, %s\n", BUDDY_BLOCK(u), k,
+			    BUDDY_ISFREE(u) ? "free" : "allocated");
+		if (!BUDDY_ISFREE(u)) {
+			nalloc++;
+			continue;
+		}
+		nfree++;
+		b = u ^ n;
+		if (b + n <= buddy_top && BUDDY_ISFREE(b) && buddy_order[b] == k) {
+			printf("Error: free buddies %p and %p are not merged\n",
+			    BUDDY_BLOCK(u), BUDDY_BLOCK(b));
+			errors++;
+		}
+	}
+	for (u = 0; u < (buddy_top + 63) / 64; u++)
+		nbits += __builtin_popcountll(buddy_isfree[u]);
+	if (nbits != nfree) {
+		printf("Error: %zu free bits are set, the heap has %zu free "
+		    "blocks\n", nbits, nfree);
+		errors++;
+	}
+	if (nalloc != alloc_blocks) {
+		printf("Error: %zu blocks are counted allocated, the heap has "
+		    "%zu\n", alloc_blocks, nalloc);
+		errors++;
+	}
+
+	/* Every free list */
+	for (k = 0; k < BUDDY_ORDERS; k++) {
+		n = 0;
+		for (l = &buddy_lists[k]; l->next != &buddy_lists[k];
+		    l = l->next) {
+			if (l->next->prev != l) {
+				printf("Error: list %d: %p links back to %p, not "
+				    "%p\n", k, l->next, l->next->prev, l);
+				errors++;
+			}
+			u = BUDDY_UNIT(l->next);
+			if ((char *)l->next < buddy_base || u >= buddy_top ||
+			    (char *)l->next != BUDDY_BLOCK(u) ||
+			    !BUDDY_ISFREE(u) || buddy_order[u] != k) {
+				printf("Error: list %d holds bad block %p\n", k,
+				    l->next);
+				errors++;
+				break;
+			}
+			if (++n > nfree) {
+				printf("Error: list %d has a cycle\n", k);
+				errors++;
+				break;
+			}
+		}
+		nlisted += n;
+		if (((buddy_map >> k) & 1) != (n != 0)) {
+			printf("Error: list %d is wrongly marked %s\n", k,
+			    n == 0 ? "non-empty" : "empty");
+			errors++;
+		}
+	}
+	if (nlisted != nfree) {
+		printf("Error: the free lists hold %zu blocks, the heap has %zu\n",
+		    nlisted, nfree);
+		errors++;
+	}
+	return (errors);
+}
+#endif
+
+#ifdef MM_QUARANTINE
+/*
+ * Requires:
+ *   "bp" is the address of an allocated block.
+ *
+ * Effects:
+ *   Poison the block "bp" and add it to the quarantine, then free the
+ *   oldest quarantined blocks, after checking their poison, until the
+ *   quarantine holds at most QUARANTINE_BYTES.  Aborts on a double free
+ *   or a write after free.
+ */
+static void
+quarantine(void *bp)
+{
+	uintptr_t *w, *end;
+	unsigned char *c;
+	size_t size = GET_SIZE(HDRP(bp));
+	size_t poison = MIN(size - DSIZE - WSIZE, (size_t)POISON_MAX);
+
+	if (GET(HDRP(bp)) & QUARANTINED) {
+		fprintf(stderr, "mm: double free of %p\n", bp);
+		abort();
+	}
+	memset((char *)bp + WSIZE, POISON_BYTE, poison);
+	PUT(HDRP(bp), PACK(size, QUARANTINED | 1));
+	PUT(FTRP(bp), PACK(size, QUARANTINED | 1));
+	*(char **)bp = NULL;
+	if (qtail != NULL)
+		*(char **)qtail = bp;
+	else
+		qhead = bp;
+	qtail = bp;
+	qbytes += size;
+
+	while (qbytes > QUARANTINE_BYTES) {
+		bp = qhead;
+		if ((qhead = *(char **)bp) == NULL)
+			qtail = NULL;
+		size = GET_SIZE(HDRP(bp));
+		qbytes -= size;
+		poison = MIN(size - DSIZE - WSIZE, (size_t)POISON_MAX);
+
+		/* Compare whole words up to the first bad one, then bytes. */
+		end = (uintptr_t *)bp + 1 + poison / WSIZE;
+		for (w = (uintptr_t *)bp + 1; w < end; w++)
+			if (*w != POISON_WORD)
+				break;
+		for (c = (unsigned char *)w;
+		    c < (unsigned char *)bp + WSIZE + poison; c++) {
+			if (*c != POISON_BYTE) {
+				fprintf(stderr, "mm: block %p was written at offset "
+				    "%zu after it was freed\n", bp,
+				    (size_t)((char *)c - (char *)bp));
+				abort();
+			}
+		}
+
+		PUT(HDRP(bp), PACK(size, 0));
+		PUT(FTRP(bp), PACK(size, 0));
+		coalesce(bp);
+		alloc_blocks--;
+	}
+}
+#endif
+
+/*
+ * The following routines are internal helper routines.
+ */
+
+/*
+ * Requires:
+ *   "bp" is the address of a newly freed block.
+ *
+ * Effects:
+ *   Perform boundary tag coalescing.  Returns the address of the coalesced
+ *   block.
+ */
+static void *
+coalesce(void *ptr) 
+{
+	HARDEN_TAG((char *)ptr - DSIZE, ptr);
+	HARDEN_TAG(HDRP(NEXT_BLKP(ptr)), ptr);
+	bool prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(ptr)));	// Get allocated status of the previous block
+	bool next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(ptr)));	// Get the allocated status of the next block
+	size_t size = GET_SIZE(HDRP(ptr));			// Size of the present block
+
+
+		
+	// Since previous and next are free, it coalesces the three of them and return the pointer to the previous block
+	if (prev_alloc && next_alloc) {                 /* Case 1 */
+		Add_Fb(ptr,size);// Adds free block to the explicitly maintained free list
+		return ptr;
+	}
+	
+	 else if (prev_alloc && !next_alloc) {         /* Case 2 */
+		CHECK_MERGED(NEXT_BLKP(ptr), ptr);
+		Delete_Fb(NEXT_BLKP(ptr),GET_SIZE(HDRP(NEXT_BLKP(ptr))));
+		// Deletes the previously embedded block from the explicictly maintained free list
+		size += GET_SIZE(HDRP(NEXT_BLKP(ptr)));//calulation of the total new size to be allocated at the new pointer location
+		PUT(HDRP(ptr), PACK(size, 0));// packs the size of the block and the allocation(0) status in the header
+		PUT(FTRP(ptr), PACK(size, 0));// packs the size of the block and the allocation(0) status in the footer
+		Add_Fb(ptr,size);// Adds free block to the explicitly maintained free list	
+	}
+	
+	 else if (!prev_alloc && next_alloc) {         /* Case 3 */
+		CHECK_MERGED(ptr, PREV_BLKP(ptr));
+		Delete_Fb(PREV_BLKP(ptr),GET_SIZE(HDRP(PREV_BLKP(ptr))));
+		size += GET_SIZE(HDRP(PREV_BLKP(ptr)));//calulation of the total new size to be allocated at the new pointer location
+		PUT(FTRP(ptr), PACK(size, 0));
+		PUT(HDRP(PREV_BLKP(ptr)), PACK(size, 0));
+		ptr = PREV_BLKP(ptr);
+		Add_Fb(ptr,size);// Adds free block to the explicitly maintained free list
+	
+	}
+	
+	 else {                                        /* Case 4 */
+		CHECK_MERGED(ptr, PREV_BLKP(ptr));
+		CHECK_MERGED(NEXT_BLKP(ptr), PREV_BLKP(ptr));
+		Delete_Fb(PREV_BLKP(ptr),GET_SIZE(HDRP(PREV_BLKP(ptr))));
+		// Deletes the Prev free block from the explicitly maintained list
+		Delete_Fb(NEXT_BLKP(ptr),GET_SIZE(HDRP(NEXT_BLKP(ptr))));
+		//Deletes the Next free block from the explicitly maintained list
+		size += GET_SIZE(HDRP(PREV_BLKP(ptr))) + 
+		    GET_SIZE(HDRP(NEXT_BLKP(ptr)));	 //calulation of the total new size to be allocated at the new pointer location
+		PUT(HDRP(PREV_BLKP(ptr)), PACK(size, 0));// packs the size of the block and the allocation(0) status in the header
+		PUT(FTRP(NEXT_BLKP(ptr)), PACK(size, 0));// packs the size of the block and the allocation(0) status in the footer
+		ptr = PREV_BLKP(ptr);
+		Add_Fb(ptr,size);		// Adds free block to the explicitly maintained free list
+	}
+	return (ptr);
+}
+
+/* 
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Extend the heap with a free block and return that block's address.
+ */
+static void *	
+extend_heap(size_t words) 
+{
+	void *bp;
+	size_t size;				// Allocate an even number of words to maintain alignment. 
+
+	/* Allocate an even number of words to maintain alignment. */
+	size = (words % 2) ? (words + 1) * WSIZE : words * WSIZE;
+	if ((bp = mem_sbrk(size)) == (void *)-1)  
+		return (NULL);
+	peak_heap = MAX(peak_heap, mem_heapsize());
+
+	/* Initialize free block header/footer and the epilogue header. */
+	PUT(HDRP(bp), PACK(size, 0));         /* Free block header */
+	PUT(FTRP(bp), PACK(size, 0));         /* Free block footer */
+	PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); /* New epilogue header */
+
+	/* Coalesce if the previous block was free. */
+	return (coalesce(bp));
+}
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Returns the address of the free block at the end of the heap (the
+ *   wilderness), or NULL if the last block is allocated.
+ */
+static void *
+wilderness(void)
+{
+	char *last = (char *)mem_heap_hi() + 1 - DSIZE; /* Last block's footer */
+
+	if (GET_ALLOC(last))
+		return (NULL);
+	return (last + DSIZE - GET_SIZE(last));
+}
+
+/*
+ * Requires:
+ *   "asize" is a multiple of DSIZE.
+ *
+ * Effects:
+ *   Extend the heap so that it ends with a free block of at least
+ *   "asize" bytes, and return that block's address, or NULL if memlib
+ *   is out of memory.  A free block at the end of the heap (the
+ *   wilderness) is merged with the extension, so only the rest of
+ *   "asize" has to be added.  The heap grows by at least "grow" bytes,
+ *   which doubles, up to 1/GROW_FRAC of the heap, while the heap keeps
+ *   growing by at least a chunk per GROW_WINDOW requests, and drops
+ *   back to CHUNKSIZE when it doesn't; a heap that grows steadily is
+ *   thus extended a logarithmic number of times.
+ */
+static void *
+grow_heap(size_t asize)
+{
+	void *wild = wilderness();
+	size_t need = asize;
+
+	if (wild != NULL && GET_SIZE(HDRP(wild)) < asize)
+		need = asize - GET_SIZE(HDRP(wild));
+	if (nmallocs - last_grow <= GROW_WINDOW * (grow / CHUNKSIZE))
+		grow = MIN(2 * grow, MAX(CHUNKSIZE, mem_heapsize() / GROW_FRAC /
+		    DSIZE * DSIZE));
+	else
+		grow = CHUNKSIZE;
+	last_grow = nmallocs;
+	return (extend_heap(MAX(need, grow) / WSIZE));
+}
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Find a fit for a block with "asize" bytes, searching bin "bin" and
+ *   the bins above it.  Returns that block's address or NULL if no
+ *   suitable block was found.  The wilderness, the free block at the
+ *   end of the heap, is kept for last: it is only used when no other
+ *   block fits, so that it stays whole for large requests and heap
+ *   growth.  TLSF keeps its bounded search time by only looking one
+ *   block further on the list when the block found is the wilderness.
+ */
+#ifdef MM_TLSF
+static void *
+find_fit(size_t asize, int bin)
+{
+	uint32_t map;
+	int list, fl;
+	void *bp;
+
+	(void)bin;
+	/* Round up, so that every block on the list found fits. */
+	if (asize >= TLSF_LINEAR)
+		asize += ((size_t)1 << (MM_LOG2(asize) - TLSF_SLI)) - 1;
+	list = tlsf_list(asize);
+	fl = list / TLSF_SL;
+	if ((map = sl_map[fl] & (~(uint32_t)0 << (list % TLSF_SL))) == 0) {
+		if (fl + 1 >= TLSF_FL ||
+		    (map = fl_map & (~(uint32_t)0 << (fl + 1))) == 0)
+			return (NULL);
+		fl = __builtin_ctz(map);
+		map = sl_map[fl];
+	}
+	list = fl * TLSF_SL + __builtin_ctz(map);
+	bp = NextFreeBlock(htp + DSIZE * list);
+
+	/* Only the last list holds blocks of unbounded size. */
+	if (list == TLSF_LISTS - 1)
+		for (; bp != 0 && GET_SIZE(HDRP(bp)) < asize;
+		    bp = NextFreeBlock(bp))
+			;
+
+	/* Prefer the next block on the list to the wilderness. */
+	if (bp != 0 && IS_WILD(bp) && NextFreeBlock(bp) != 0 &&
+	    GET_SIZE(HDRP(NextFreeBlock(bp))) >= asize)
+		bp = NextFreeBlock(bp);
+	return (bp);
+}
+
+/* 
+ * Requires:
+ *   "size" is a block size.
+ *
+ * Effects:
+ *   Returns the TLSF list for free blocks of "size" bytes.
+ */
+static inline int
+tlsf_list(size_t size)
+{
+	int f;
+
+	if (size < TLSF_LINEAR)
+		return ((int)(size / DSIZE));
+	f = MM_LOG2(size);
+	if (f - TLSF_SHIFT >= TLSF_FL)
+		return (TLSF_LISTS - 1);
+	return ((f - TLSF_SHIFT) * TLSF_SL +
+	    (int)(size >> (f - TLSF_SLI)) - TLSF_SL);
+}
+#else
+static void *
+find_fit(size_t asize, int bin)
+{
+	struct fit_index *fi;
+	void *bp;
+	uint64_t map;
+	int num;
+
+	/* Only visit the bins that have free blocks. */
+	for (map = bin_map >> bin << bin; map != 0; map &= map - 1) {
+		num = __builtin_ctzll(map);
+
+		/* A small bin holds one size, which is at least asize. */
+		if (num < MM_SMALL_BINS) {
+			bp = NextFreeBlock(htp + DSIZE * num);
+			if (!IS_WILD(bp))
+				return (bp);
+			if ((bp = NextFreeBlock(bp)) != 0)
+				return (bp);
+			continue;
+		}
+		fi = &fits[num - MM_SMALL_BINS];
+		if (!fi->on && bin_blocks[num] >= FIT_BUILD)
+			fit_build(fi, num);
+		if (fi->on) {
+			if ((bp = fit_search(fi, asize)) != NULL)
+				return (bp);
+			continue;
+		}
+
+		/* Search for the first fit. */
+		for (bp = NextFreeBlock(htp + DSIZE * num); bp != 0;
+		    bp = NextFreeBlock(bp))
+			if (asize <= GET_SIZE(HDRP(bp)) && !IS_WILD(bp))
+				return (bp);
+	}
+	/* No other fit was found.  Try the wilderness. */
+	if ((bp = wilderness()) != NULL && asize <= GET_SIZE(HDRP(bp)))
+		return (bp);
+	return (NULL);
+}
+
+/* 
+ * Requires:
+ *   "cap" is at least the number of entries in use in "fi".
+ *
+ * Effects:
+ *   Move the fit index "fi" to new arrays with room for "cap" entries.
+ *   Returns true if successful and false, leaving "fi" as it was, if
+ *   they couldn't be allocated.
+ */
+static bool
+fit_grow(struct fit_index *fi, size_t cap)
+{
+	uint32_t *sizes;
+
+	sizes = mmap(NULL, cap * (sizeof(uint32_t) + sizeof(void *)),
+	    PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (sizes == MAP_FAILED)
+		return (false);
+	if (fi->cap > 0) {
+		memcpy(sizes, fi->sizes, fi->n * sizeof(uint32_t));
+		memcpy(sizes + cap, fi->blocks, fi->n * sizeof(void *));
+		munmap(fi->sizes, fi->cap * (sizeof(uint32_t) +
+		    sizeof(void *)));
+	}
+	fi->sizes = sizes;
+	fi->blocks = (void **)(sizes + cap);
+	fi->cap = cap;
+	return (true);
+}
+
+/* 
+ * Requires:
+ *   "fi" is the fit index of bin "num", which isn't indexed.
+ *
+ * Effects:
+ *   Index the blocks in bin "num", oldest first.  Leaves the bin
+ *   unindexed if the arrays can't be allocated.
+ */
+static void
+fit_build(struct fit_index *fi, int num)
+{
+	size_t cap, i;
+	void *bp;
+
+	fi->n = fi->dead = 0;
+	for (cap = MAX(fi->cap, FIT_MIN); cap < 2 * bin_blocks[num]; cap *= 2)
+		;
+	if (cap > fi->cap && !fit_grow(fi, cap))
+		return;
+	i = bin_blocks[num];
+	for (bp = NextFreeBlock(htp + DSIZE * num); bp != 0;
+	    bp = NextFreeBlock(bp)) {
+		i--;
+		fi->sizes[i] = GET_SIZE(HDRP(bp)) / DSIZE;
+		fi->blocks[i] = bp;
+		FIT_SLOT(bp) = i;
+	}
+	fi->n = bin_blocks[num];
+	fi->on = true;
+}
+
+/* 
+ * Requires:
+ *   "bp" is a free block of "size" bytes that is being added to the bin
+ *   of the fit index "fi".
+ *
+ * Effects:
+ *   If the bin is indexed, append "bp" to the fit index, compacting or
+ *   growing its arrays if they are full.  If they can't be grown, the
+ *   bin stops being indexed.
+ */
+static void
+fit_add(struct fit_index *fi, void *bp, size_t size)
+{
+	size_t i, j;
+
+	if (!fi->on)
+		return;
+	if (fi->n == fi->cap) {
+		if (fi->dead >= fi->cap / 2) {
+			/* Squeeze out the deleted entries, keeping the order. */
+			for (i = j = 0; i < fi->n; i++) {
+				if (fi->sizes[i] == 0)
+					continue;
+				fi->sizes[j] = fi->sizes[i];
+				fi->blocks[j] = fi->blocks[i];
+				FIT_SLOT(fi->blocks[j]) = j;
+				j++;
+			}
+			fi->n = j;
+			fi->dead = 0;
+		} else if (!fit_grow(fi, 2 * fi->cap)) {
+			fi->on = false;
+			return;
+		}
+	}
+	fi->sizes[fi->n] = size / DSIZE;
+	fi->blocks[fi->n] = bp;
+	FIT_SLOT(bp) = fi->n++;
+}
+
+/* 
+ * Requires:
+ *   "bp" is a free block that is being removed from the bin of the fit
+ *   index "fi".
+ *
+ * Effects:
+ *   If the bin is indexed, mark the entry of "bp" in the fit index as
+ *   deleted and drop any deleted entries from the end of the arrays.
+ *   The bin stops being indexed once it is empty.
+ */
+static void
+fit_delete(struct fit_index *fi, void *bp)
+{
+	size_t i;
+
+	if (!fi->on)
+		return;
+	i = FIT_SLOT(bp);
+#ifdef MM_HARDEN
+	if (i >= fi->n || fi->blocks[i] != bp || fi->sizes[i] == 0)
+		harden_fail("corrupted fit index", bp);
+#endif
+	fi->sizes[i] = 0;
+	fi->dead++;
+	while (fi->n > 0 && fi->sizes[fi->n - 1] == 0) {
+		fi->n--;
+		fi->dead--;
+	}
+	if (fi->n == 0)
+		fi->on = false;
+}
+
+/* 
+ * Requires:
+ *   "fi" is the fit index of an indexed bin.
+ *
+ * Effects:
+ *   Find the most recently added block in the fit index, other than
+ *   the wilderness, that has at least "asize" bytes.  Returns that
+ *   block's address or NULL if there is none.
+ */
+static void *
+fit_search(const struct fit_index *fi, size_t asize)
+{
+	uint32_t need = asize / DSIZE;
+	size_t i = fi->n;
+#ifdef __SSE2__
+	__m128i min = _mm_set1_epi32((int)need - 1);
+	int mask, bit;
+
+	/* Line up on a group of four, then compare four sizes at once. */
+	for (; i % 4 != 0; i--)
+		if (fi->sizes[i - 1] >= need && !IS_WILD(fi->blocks[i - 1]))
+			return (fi->blocks[i - 1]);
+	for (; i > 0; i -= 4) {
+		__builtin_prefetch(&fi->sizes[i > 64 ? i - 64 : 0]);
+		mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(
+		    _mm_load_si128((const __m128i *)&fi->sizes[i - 4]), min)));
+		for (; mask != 0; mask &= ~(1 << bit)) {
+			bit = 31 - __builtin_clz(mask);
+			if (!IS_WILD(fi->blocks[i - 4 + bit]))
+				return (fi->blocks[i - 4 + bit]);
+		}
+	}
+#else
+	while (i-- > 0)
+		if (fi->sizes[i] >= need && !IS_WILD(fi->blocks[i]))
+			return (fi->blocks[i]);
+#endif
+	return (NULL);
+}
+#endif /* MM_TLSF */
+
+/* 
+ * Requires:
+ *   "bp" is the address of a free block that is at least "asize" bytes.
+ *
+ * Effects:
+ *   Place a block of "asize" bytes in the free block "bp" and split that
+ *   block if the remainder would be at least params.split_min bytes (by
+ *   default the minimum block size).  Returns the address of the placed
+ *   block.  Blocks of params.place_high bytes or more go at the end of
+ *   "bp" and smaller ones at the start, so that large and small blocks
+ *   gather at opposite ends of the free space they are carved from.
+ *   The wilderness (see find_fit) is always split at its start, so that
+ *   the heap keeps ending with a free block.
+ */
+static void *
+place(void *bp, size_t asize)
+{
+	size_t csize = GET_SIZE(HDRP(bp));   		//computes the size of the block
+	void *rest;
+
+	HARDEN_TAG(HDRP(bp), bp);
+
+	if ((csize - asize) >= params.split_min) { 
+		Delete_Fb(bp,csize);
+		if (params.place_high != 0 && asize >= params.place_high &&
+		    !IS_WILD(bp)) {
+			rest = bp;		/* The remainder comes first */
+			bp = (char *)bp + csize - asize;
+		} else
+			rest = (char *)bp + asize;
+		PUT(HDRP(bp), PACK(asize, 1));//packs the size of the block and the allocation(1) status in the header
+		PUT(FTRP(bp), PACK(asize, 1));//packs the size of the block and the allocation(1) status in the footer
+		PUT(HDRP(rest), PACK(csize - asize, 0));	//packs the size of the remainder and the allocation(0) status in the header
+		PUT(FTRP(rest), PACK(csize - asize, 0));  //packs the size of the remainder and the allocation(0) status in the footer
+		Add_Fb(rest,csize-asize);//Adds the newly created block to the explicitly maintained free list
+	} else {
+		PUT(HDRP(bp), PACK(csize, 1));//packs the size of the block and the allocation(1) status in the header
+		PUT(FTRP(bp), PACK(csize, 1));//packs the size of the block and the allocation(1) status in the footer
+		Delete_Fb(bp,csize);//Deletes the block  from the explicictly maintained free list
+	}
+	return (bp);
+}
+
+#ifdef MM_HARDEN
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Report heap corruption or misuse ("what") at the block "bp" and
+ *   abort.
+ */
+static void
+harden_fail(const char *what, void *bp)
+{
+
+	fprintf(stderr, "mm: %s at %p\n", what, bp);
+	abort();
+}
+
+/*
+ * Requires:
+ *   "bp" was passed to mm_free or mm_realloc.
+ *
+ * Effects:
+ *   Abort unless "bp" is an allocated block with an intact header and
+ *   footer.
+ */
+static void
+harden_block(void *bp)
+{
+
+	if ((uintptr_t)bp % DSIZE != 0 || !TAG_OK(HDRP(bp)))
+		harden_fail("invalid pointer or corrupted header", bp);
+	if (!GET_ALLOC(HDRP(bp)))
+		harden_fail("double free", bp);
+	if (GET(FTRP(bp)) != GET(HDRP(bp)))
+		harden_fail("corrupted footer (overflow?)", bp);
+}
+#endif
+
+/* 
+ * The remaining routines are heap consistency checker routines. 
+ */
+
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Returns true if "p" lies within the blocks of the heap.
+ */
+static bool
+in_heap(const void *p)
+{
+
+	return ((const char *)p >= heap_listp &&
+	    (const char *)p <= (char *)mem_heap_hi());
+}
+
+/*
+ * Requires:
+ *   "bp" is the address of a block after the prologue.
+ *
+ * Effects:
+ *   Check the block "bp" on its own and against the block after it:
+ *   alignment, size, matching header and footer, and that no two free
+ *   blocks are adjacent.  A free block's list links are checked by
+ *   checkfree.  Prints each problem and returns the number found.
+ */
+static int
+checkblock(void *bp) 
+{
+	size_t size = GET_SIZE(HDRP(bp));
+	int errors = 0;
+
+	if ((uintptr_t)bp % DSIZE) {
+		printf("Error: %p is not doubleword aligned\n", bp);
+		return (1);
+	}
+	if (size < 2 * DSIZE ||
+	    (char *)bp + size > (char *)mem_heap_hi() + 1) {
+		printf("Error: %p has bad size %zu\n", bp, size);
+		return (1);
+	}
+	if (!TAG_OK(HDRP(bp)) || !TAG_OK(FTRP(bp))) {
+		printf("Error: %p has a bad header or footer checksum\n", bp);
+		errors++;
+	}
+	if (GET(HDRP(bp)) != GET(FTRP(bp))) {
+		printf("Error: %p header %zu does not match footer %zu\n", bp,
+		    (size_t)GET(HDRP(bp)), (size_t)GET(FTRP(bp)));
+		errors++;
+	}
+	if (!GET_ALLOC(HDRP(bp))) {
+		if (!GET_ALLOC(HDRP(NEXT_BLKP(bp)))) {
+			printf("Error: free blocks %p and %p are not coalesced\n",
+			    bp, NEXT_BLKP(bp));
+			errors++;
+		}
+		errors += checkfree(bp);
+	}
+	return (errors);
+}
+
+/*
+ * Requires:
+ *   "bp" is the address of a free block.
+ *
+ * Effects:
+ *   Check that the free list links of "bp" are symmetric: its
+ *   predecessor (a free block or the head of its bin) links forward to
+ *   it, its successor links back to it, and both neighbors belong to
+ *   the bin for the size of "bp".  Prints each problem and returns the
+ *   number found.
+ */
+static int
+checkfree(void *bp)
+{
+	int bin = LIST(GET_SIZE(HDRP(bp)));
+	char *binhead = htp + DSIZE * bin;
+	char *prev = PreviousFreeBlock(bp);
+	char *next = NextFreeBlock(bp);
+	int errors = 0;
+
+	if (prev == binhead) {
+		if (NextFreeBlock(binhead) != bp) {
+			printf("Error: %p is linked to bin %d but is not its "
+			    "first block\n", bp, bin);
+			errors++;
+		}
+	} else if (prev >= htp && prev < htp + NHEADS * DSIZE) {
+		printf("Error: %p is first in bin %d, should be in bin %d\n",
+		    bp, (int)((prev - htp) / DSIZE), bin);
+		errors++;
+	} else if (!in_heap(prev) || (uintptr_t)prev % DSIZE ||
+	    GET_ALLOC(HDRP(prev))) {
+		printf("Error: %p has bad previous free block %p\n", bp, prev);
+		errors++;
+	} else if (NextFreeBlock(prev) != bp) {
+		printf("Error: %p's previous free block %p links to %p\n", bp,
+		    prev, NextFreeBlock(prev));
+		errors++;
+	} else if (LIST(GET_SIZE(HDRP(prev))) != bin) {
+		printf("Error: %p (bin %d) is linked to %p (bin %d)\n", bp, bin,
+		    prev, LIST(GET_SIZE(HDRP(prev))));
+		errors++;
+	}
+
+	if (next == NULL)
+		return (errors);
+	if (!in_heap(next) || (uintptr_t)next % DSIZE ||
+	    GET_ALLOC(HDRP(next))) {
+		printf("Error: %p has bad next free block %p\n", bp, next);
+		errors++;
+	} else if (PreviousFreeBlock(next) != bp) {
+		printf("Error: %p's next free block %p links back to %p\n", bp,
+		    next, PreviousFreeBlock(next));
+		errors++;
+	}
+	return (errors);
+}
+
+/* 
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Check the heap (every arena in NUMA mode) with checkarena.  Prints
+ *   each problem (and every block if "verbose") and returns the number
+ *   of problems found.
+ */
+int
+mm_checkheap(int verbose) 
+{
+#ifdef MM_NUMA
+	int a, cur = cur_arena, errors = 0;
+
+	for (a = 0; a < numa_narenas; a++) {
+		NUMA_SWITCH(a);
+		if (verbose)
+			printf("Arena %d:\n", a);
+		errors += checkarena(verbose);
+	}
+	NUMA_SWITCH(cur);
+	return (errors);
+#else
+	return (checkarena(verbose));
+#endif
+}
+
+/* 
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Check the current heap for consistency: the prologue and epilogue,
+ *   every block with checkblock, and every free list.  Each free list
+ *   must hold exactly the free blocks of its size class, linked in both
+ *   directions, and the counts behind mm_stats must match.  Prints each
+ *   problem (and every block if "verbose") and returns the number of
+ *   problems found.
+ */
+static int
+checkarena(int verbose) 
+{
+	size_t walk_bytes[MM_NBINS], walk_blocks[MM_NBINS], nfree = 0, n;
+	size_t nlisted = 0;
+#ifndef MM_TLSF
+	size_t j, ndead;
+	struct fit_index *fi;
+#endif
+	char *bp, *prev;
+	int errors = 0, i;
+
+#ifdef MM_GUARD
+	return (0);	/* No free lists; the guard pages do the checking. */
+#endif
+#ifdef MM_BUDDY
+	return (buddy_check(verbose));
+#endif
+	memset(walk_bytes, 0, sizeof(walk_bytes));
+	memset(walk_blocks, 0, sizeof(walk_blocks));
+	if (verbose)
+		printf("Heap (%p):\n", heap_listp);
+
+	if (GET(HDRP(heap_listp)) != PACK(DSIZE, 1) ||
+	    GET(FTRP(heap_listp)) != PACK(DSIZE, 1)) {
+		printf("Error: bad prologue\n");
+		errors++;
+	}
+
+	/* Every block, in address order */
+	for (bp = NEXT_BLKP(heap_listp); GET_SIZE(HDRP(bp)) > 0;
+	    bp = NEXT_BLKP(bp)) {
+		if (verbose)
+			printblock(bp);
+		if ((n = checkblock(bp)) > 0) {
+			errors += n;
+			if ((uintptr_t)bp % DSIZE ||
+			    GET_SIZE(HDRP(bp)) < 2 * DSIZE ||
+			    bp + GET_SIZE(HDRP(bp)) > (char *)mem_heap_hi() + 1)
+				return (errors);	/* Can't go on. */
+		}
+		if (!GET_ALLOC(HDRP(bp))) {
+			walk_bytes[BIN(GET_SIZE(HDRP(bp)))] += GET_SIZE(HDRP(bp));
+			walk_blocks[BIN(GET_SIZE(HDRP(bp)))]++;
+			nfree++;
+		}
+	}
+	if (verbose)
+		printblock(bp);
+	if (!GET_ALLOC(HDRP(bp)) || HDRP(bp) != (char *)mem_heap_hi() + 1 - WSIZE) {
+		printf("Error: bad epilogue header at %p\n", HDRP(bp));
+		errors++;
+	}
+
+	/*
+	 * Every free list.  checkblock has already checked the links of
+	 * each free block in the heap; this makes sure each block is
+	 * reachable from exactly the right head.
+	 */
+	for (i = 0; i < NHEADS; i++) {
+		prev = htp + DSIZE * i;
+		n = 0;
+		for (bp = NextFreeBlock(prev); bp != NULL; bp = NextFreeBlock(bp)) {
+			if (i >= NLISTS || !in_heap(bp) ||
+			    (uintptr_t)bp % DSIZE || GET_ALLOC(HDRP(bp)) ||
+			    LIST(GET_SIZE(HDRP(bp))) != i) {
+				printf("Error: bin %d holds bad block %p\n", i, bp);
+				errors++;
+				break;
+			}
+			if (PreviousFreeBlock(bp) != prev) {
+				printf("Error: bin %d: %p links back to %p, not %p\n",
+				    i, bp, PreviousFreeBlock(bp), prev);
+				errors++;
+			}
+			if (++n > nfree) {
+				printf("Error: bin %d has a cycle\n", i);
+				errors++;
+				break;
+			}
+			prev = bp;
+		}
+		nlisted += n;
+#ifdef MM_TLSF
+		if (i < NLISTS &&
+		    ((sl_map[i / TLSF_SL] >> (i % TLSF_SL)) & 1) != (n != 0)) {
+			printf("Error: list %d is wrongly marked %s\n", i,
+			    n == 0 ? "non-empty" : "empty");
+			errors++;
+		}
+#else
+		if (i < MM_NBINS && n != walk_blocks[i]) {
+			printf("Error: bin %d lists %zu blocks, the heap has %zu\n",
+			    i, n, walk_blocks[i]);
+			errors++;
+		}
+#endif
+	}
+	if (nlisted != nfree) {
+		printf("Error: the free lists hold %zu blocks, the heap has %zu\n",
+		    nlisted, nfree);
+		errors++;
+	}
+#ifdef MM_TLSF
+	for (i = 0; i < TLSF_FL; i++)
+		if (((fl_map >> i) & 1) != (sl_map[i] != 0)) {
+			printf("Error: class %d is wrongly marked %s\n", i,
+			    sl_map[i] == 0 ? "non-empty" : "empty");
+			errors++;
+		}
+#endif
+
+	/* The statistics of every bin */
+	for (i = 0; i < MM_NBINS; i++) {
+		if (bin_blocks[i] != walk_blocks[i] ||
+		    bin_bytes[i] != walk_bytes[i]) {
+			printf("Error: bin %d counts %zu blocks/%zu bytes, the "
+			    "heap has %zu/%zu\n", i, bin_blocks[i], bin_bytes[i],
+			    walk_blocks[i], walk_bytes[i]);
+			errors++;
+		}
+		if (((bin_map >> i) & 1) != (walk_blocks[i] != 0)) {
+			printf("Error: bin %d is wrongly marked %s\n", i,
+			    (bin_map >> i) & 1 ? "non-empty" : "empty");
+			errors++;
+		}
+	}
+
+#ifndef MM_TLSF
+	/*
+	 * Every fit index.  Each live entry must be a free block of the
+	 * right bin and size that points back at the entry, so with as
+	 * many live entries as blocks in the bin, each block has one.
+	 */
+	for (i = MM_SMALL_BINS; i < MM_NBINS; i++) {
+		fi = &fits[i - MM_SMALL_BINS];
+		if (!fi->on)
+			continue;
+		n = ndead = 0;
+		for (j = 0; j < fi->n; j++) {
+			if (fi->sizes[j] == 0) {
+				ndead++;
+				continue;
+			}
+			bp = fi->blocks[j];
+			if (!in_heap(bp) || (uintptr_t)bp % DSIZE ||
+			    GET_ALLOC(HDRP(bp)) ||
+			    GET_SIZE(HDRP(bp)) != fi->sizes[j] * DSIZE ||
+			    BIN(GET_SIZE(HDRP(bp))) != i || FIT_SLOT(bp) != j) {
+				printf("Error: bin %d: bad fit index entry %zu "
+				    "for %p\n", i, j, bp);
+				errors++;
+				break;
+			}
+			n++;
+		}
+		if (n != walk_blocks[i] || ndead != fi->dead) {
+			printf("Error: bin %d: fit index has %zu blocks and %zu "
+			    "deleted entries, not %zu and %zu\n", i, n, ndead,
+			    walk_blocks[i], fi->dead);
+			errors++;
+		}
+	}
+#endif
+	return (errors);
+}
+
+#ifdef MM_CHECK
+/*
+ * Requires:
+ *   None.
+ *
+ * Effects:
+ *   Check the next CHECK_SLICE blocks of the heap, starting over at the
+ *   first block after reaching the epilogue.  Aborts with a report of
+ *   the whole heap if one is corrupt.
+ */
+static void
+checkslice(void)
+{
+	int i;
+
+	if (check_cursor == NULL)
+		check_cursor = NEXT_BLKP(heap_listp);
+	for (i = 0; i < CHECK_SLICE; i++) {
+		if (GET_SIZE(HDRP(check_cursor)) == 0) {
+			if (HDRP(check_cursor) != (char *)mem_heap_hi() + 1 - WSIZE)
+				break;
+			check_cursor = NEXT_BLKP(heap_listp);
+		}
+		if (checkblock(check_cursor) > 0)
+			break;
+		check_cursor = NEXT_BLKP(check_cursor);
+	}
+	if (i == CHECK_SLICE)
+		return;
+	fprintf(stderr, "mm: heap corruption at %p\n", check_cursor);
+	fflush(stdout);
+	mm_checkheap(false);
+	abort();
+}
+#endif
+
+/*
+ * Requires:
+ *   "bp" is the address of a block.
+ *
+ * Effects:
+ *   Print the block "bp".
+ */
+static void
+printblock(void *bp) 
+{
+	bool halloc, falloc;
+	size_t hsize, fsize;
+
+	hsize = GET_SIZE(HDRP(bp));
+	halloc = GET_ALLOC(HDRP(bp));  
+	fsize = GET_SIZE(FTRP(bp));
+	falloc = GET_ALLOC(FTRP(bp));  
 
 	if (hsize == 0) {
 		printf("%p: end of heap\n", bp);
@@ -582,6 +2917,38 @@ printblock(void *bp)
 	printf("%p: header: [%zu:%c] footer: [%zu:%c]\n", bp, hsize, (halloc ? 'a' :'f') ,fsize, (falloc ? 'a' : 'f'));
 }
 
+#ifdef MM_ENGINE
+/*
+ * This build's entry in mdriver's engine table (see mmengine.h).
+ */
+#define ENGINE_STR(e)  ENGINE_STR2(e)
+#define ENGINE_STR2(e) #e
+
+static const mm_engine_t engine = {
+	ENGINE_STR(MM_ENGINE),
+#if defined(MM_BUDDY)
+	"binary buddy allocator",
+#elif defined(MM_TLSF)
+	"TLSF free lists",
+#elif defined(MM_HARDEN)
+	"segregated free lists, hardened",
+#elif defined(MM_QUARANTINE)
+	"segregated free lists with a quarantine",
+#else
+	"segregated free lists",
+#endif
+	mm_init, mm_malloc, mm_free, mm_realloc, mm_usable_size,
+	MM_ENGINE_SYM(mm_stats), mm_checkheap
+};
+
+static void __attribute__((constructor))
+register_engine(void)
+{
+
+	mm_engine_register(&engine);
+}
+#endif
+
 /*
  * The last lines of this file configures the behavior of the "Tab" key in
  * emacs.  Emacs has a rudimentary understanding of C syntax and style.  In
@@ -3,10 +3,139 @@
  * The public interface to the students' memory allocator.
  */
 
+/*
+ * A build with -DMM_TUNE='"<header>"' takes MM_SMALL_MAX below, and
+ * the default MM_SPLIT_MIN and MM_CHUNKSIZE of struct mm_params, from
+ * a header that traceinfo derives from a set of traces.  MM_NBINS
+ * stays fixed, since it sizes struct mm_stats.
+ */
+#ifdef MM_TUNE
+#include MM_TUNE
+#endif
+
+#include <stdint.h>
+
+/* Number of segregated free lists (size classes) in mm.c */
+#define MM_NBINS 50
+
+/*
+ * Size classes.  A request for size bytes gets a block of
+ * MM_CLASS_SIZE(size) bytes (the payload plus header and footer,
+ * rounded up to a doubleword), and a free block of b bytes is kept in
+ * bin MM_SIZE_BIN(b): one bin per block size below MM_SMALL_MAX, so
+ * that any block in a request's bin fits it, and above that two bins
+ * per power of two, up to the last bin.  mm.c looks small sizes up in
+ * tables that mksizetab generates from these macros (sizetab.h); for
+ * a constant size the compiler folds them.  Requests above
+ * MM_REQUEST_MAX fail with ENOMEM (like glibc's above PTRDIFF_MAX), so
+ * that these and the other size computations never wrap.
+ */
+#define MM_DSIZE      (2 * sizeof(void *))
+#ifndef MM_SMALL_MAX
+#define MM_SMALL_MAX  512
+#endif
+#define MM_SMALL_BINS ((int)(MM_SMALL_MAX / MM_DSIZE) - 2)
+#define MM_REQUEST_MAX ((size_t)PTRDIFF_MAX - 4 * MM_DSIZE)
+#define MM_CLASS_SIZE(size) ((size) <= MM_DSIZE ? 2 * MM_DSIZE :	\
+	((size) + 2 * MM_DSIZE - 1) & ~(MM_DSIZE - 1))
+#define MM_LOG2(b)    (63 - __builtin_clzll((unsigned long long)(b)))
+#define MM_LARGE_BIN(b) (MM_SMALL_BINS +				\
+	2 * (MM_LOG2(b) - MM_LOG2(MM_SMALL_MAX)) +			\
+	(int)(((b) >> (MM_LOG2(b) - 1)) & 1))
+#define MM_SIZE_BIN(b) ((b) < MM_SMALL_MAX ?				\
+	(int)((b) / MM_DSIZE) - 2 :					\
+	MM_LARGE_BIN(b) >= MM_NBINS ? MM_NBINS - 1 : MM_LARGE_BIN(b))
+
+/* Heap statistics reported by mm_stats */
+struct mm_stats {
+    size_t heap_size;        /* current heap size in bytes */
+    size_t peak_heap_size;   /* largest heap size since mm_init */
+    size_t alloc_bytes;      /* bytes in allocated blocks, incl. overhead */
+    size_t alloc_blocks;     /* number of allocated blocks */
+    size_t free_bytes;       /* bytes in free blocks */
+    size_t free_blocks;      /* number of free blocks */
+    size_t largest_free;     /* size of the largest free block */
+    double ext_frag;         /* external fragmentation, 1 - largest/free */
+    size_t bin_free_bytes[MM_NBINS];  /* free bytes per size class */
+    size_t bin_free_blocks[MM_NBINS]; /* free blocks per size class */
+};
+
+/*
+ * Parameters that mm_set_params changes at run time, starting with the
+ * next mm_init; the defaults can come from an MM_TUNE header.  They
+ * can be written as a string like "chunksize=4096,split_min=32,nbins=50"
+ * for mm_parse_params (and MM_PARAMS in libmm.so).
+ */
+struct mm_params {
+    size_t chunksize;        /* least amount the heap is extended by */
+    size_t split_min;        /* smallest remainder place() splits off */
+    int nbins;               /* bins in use; larger blocks share the last */
+    size_t place_high;       /* blocks this large go at a free block's end */
+};
+#define MM_CHUNKSIZE_MAX (1UL << 30)
+
+/* Flags for mm_malloc_flags */
+#define MM_NOSHARE 0x1  /* don't share cache lines with other blocks */
+#define MM_LINE    64   /* cache line size assumed by MM_NOSHARE */
+
+/*
+ * mm.c compiled with -DMM_ENGINE=<name> is one of several allocator
+ * engines linked into the same mdriver (see mmengine.h), so its
+ * external names get a <name>_ prefix to keep them apart from mm.o's.
+ * mm_stats is also the name of the struct above, so only calls to it
+ * are renamed, and its address is taken with MM_ENGINE_SYM.
+ */
+#ifdef MM_ENGINE
+#define MM_ENGINE_SYM(f)      MM_ENGINE_CAT(MM_ENGINE, f)
+#define MM_ENGINE_CAT(e, f)   MM_ENGINE_CAT2(e, f)
+#define MM_ENGINE_CAT2(e, f)  e##_##f
+#define mm_init               MM_ENGINE_SYM(mm_init)
+#define mm_malloc             MM_ENGINE_SYM(mm_malloc)
+#define mm_malloc_class       MM_ENGINE_SYM(mm_malloc_class)
+#define mm_free               MM_ENGINE_SYM(mm_free)
+#define mm_realloc            MM_ENGINE_SYM(mm_realloc)
+#define mm_memalign           MM_ENGINE_SYM(mm_memalign)
+#define mm_malloc_flags       MM_ENGINE_SYM(mm_malloc_flags)
+#define mm_usable_size        MM_ENGINE_SYM(mm_usable_size)
+#define mm_stats(st)          MM_ENGINE_SYM(mm_stats)(st)
+#define mm_checkheap          MM_ENGINE_SYM(mm_checkheap)
+#define mm_set_params         MM_ENGINE_SYM(mm_set_params)
+#define mm_get_params         MM_ENGINE_SYM(mm_get_params)
+#define mm_parse_params       MM_ENGINE_SYM(mm_parse_params)
+#define mm_numa_set_node      MM_ENGINE_SYM(mm_numa_set_node)
+#define mm_numa_nodes         MM_ENGINE_SYM(mm_numa_nodes)
+#define team                  MM_ENGINE_SYM(team)
+#endif
+
 int mm_init(void);
 void *mm_malloc(size_t size);
+void *mm_malloc_class(size_t size, size_t asize, int bin);
 void mm_free(void *ptr);
 void *mm_realloc(void *ptr, size_t size);
+void *mm_memalign(size_t alignment, size_t size);
+void *mm_malloc_flags(size_t size, int flags);
+size_t mm_usable_size(void *ptr);
+void mm_stats(struct mm_stats *st);
+int mm_checkheap(int verbose);
+int mm_set_params(const struct mm_params *p);
+void mm_get_params(struct mm_params *p);
+int mm_parse_params(const char *s, struct mm_params *p);
+void mm_numa_set_node(int node);
+int mm_numa_nodes(void);
+
+/*
+ * mm_malloc_inline - mm_malloc for callers that can inline the size
+ *     class lookup: for a constant size the block size and bin are
+ *     computed at compile time and the call goes straight to
+ *     mm_malloc_class
+ */
+static inline void *mm_malloc_inline(size_t size)
+{
+    if (__builtin_constant_p(size) && size > 0 && size < MM_SMALL_MAX)
+	return mm_malloc_class(size, MM_CLASS_SIZE(size),
+			       MM_SIZE_BIN(MM_CLASS_SIZE(size)));
+    return mm_malloc(size);
+}
 
 /* 
  * Students work in teams of one or two.  Teams enter their team name, personal
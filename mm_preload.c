@@ -0,0 +1,481 @@
+/*
+ * mm_preload.c - Run the mm.c allocator as the process malloc
+ *
+ * Built together with mm.c and memlib.c into libmm.so, which exports
+ * the standard allocation entry points mapped onto mm_*:
+ *
+ *     LD_PRELOAD=./libmm.so some-program args...
+ *
+ * mm.c is not thread-safe, so every request runs under one mutex.  The
+ * heap lives in memlib's mmap'ed region, which libmm.so reserves with a
+ * much larger MAX_HEAP than mdriver uses.
+ *
+ * If the environment variable MM_TRACE names a file, every request is
+ * also logged there in the binary format of mmtrace.h; trace2rep turns
+ * the log into a .rep trace that mdriver can replay.  Logging is
+ * lock-free: each thread fills its own buffer and appends it with a
+ * single write() when it is full, when the thread exits, and when the
+ * process exits.  Requests are ordered by a sequence number taken from
+ * an atomic counter while the allocator lock is held, so the order in
+ * the log matches the order in which the heap changed.  A forked child
+ * stops logging, since it would otherwise reuse the parent's sequence
+ * numbers.
+ *
+ * If MM_PROFILE names a file, libmm.so is built with mm.c's sampling
+ * heap profiler (mmprof.h): about one allocation per MM_PROFILE_RATE
+ * bytes (default MMPROF_PERIOD) has its call stack recorded, and the
+ * live heap by allocation site is written to the file in pprof's heap
+ * profile format at exit, or whenever the program calls
+ * libmm_prof_dump.
+ *
+ * MM_PARAMS sets mm.c's run-time parameters, in the form taken by
+ * mm_parse_params ("chunksize=16384,split_min=64,nbins=40"), such as
+ * a config written by "mdriver -u".
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "memlib.h"
+#include "mm.h"
+#include "mmprof.h"
+#include "mmtrace.h"
+
+#define EXPORT __attribute__((visibility("default")))
+
+#define TRACE_BUFRECS    4096  /* records per thread buffer */
+#define TRACE_MAXTHREADS 1024  /* buffers remembered for the exit flush */
+
+/* Per-thread trace buffer */
+typedef struct {
+    int n;                            /* records in rec[] */
+    uint32_t tid;
+    mmtrace_rec_t rec[TRACE_BUFRECS];
+} tbuf_t;
+
+static pthread_mutex_t mm_lock = PTHREAD_MUTEX_INITIALIZER;
+static int initialized = 0;
+
+static int trace_fd = -1;             /* MM_TRACE file, or -1 */
+static uint64_t trace_seq = 0;        /* next sequence number */
+static tbuf_t *trace_bufs[TRACE_MAXTHREADS];
+static int trace_nbufs = 0;
+static pthread_key_t trace_key;
+static __thread tbuf_t *my_buf = NULL;
+
+static char *prof_path = NULL;        /* MM_PROFILE file, or NULL */
+
+/*
+ * heap_init - Set up memlib and mm.c, with the parameters in MM_PARAMS
+ *     if it is set, on the first request.  Called with mm_lock held.
+ */
+static void heap_init(void)
+{
+    static const char bad[] = "libmm: ignoring bad MM_PARAMS\n";
+    struct mm_params params;
+    char *s;
+
+    mem_init();
+    if ((s = getenv("MM_PARAMS")) != NULL && *s != '\0') {
+	mm_get_params(&params);
+	if (mm_parse_params(s, &params) < 0 || mm_set_params(&params) < 0)
+	    write(STDERR_FILENO, bad, sizeof(bad) - 1);
+    }
+    if (mm_init() < 0) {
+	static const char msg[] = "libmm: mm_init failed\n";
+	write(STDERR_FILENO, msg, sizeof(msg) - 1);
+	abort();
+    }
+    initialized = 1;
+}
+
+/*
+ * in_heap - Is ptr a block that mm.c handed out?  Pointers from
+ *     elsewhere (e.g. memory the dynamic loader set up before us) are
+ *     ignored rather than corrupting the heap.
+ */
+static int in_heap(void *ptr)
+{
+    return initialized && (char *)ptr >= (char *)mem_heap_lo() &&
+	(char *)ptr <= (char *)mem_heap_hi();
+}
+
+/*
+ * trace_flush - Append the records in b to the trace file
+ */
+static void trace_flush(tbuf_t *b)
+{
+    if (b->n > 0 && trace_fd >= 0)
+	write(trace_fd, b->rec, b->n * sizeof(mmtrace_rec_t));
+    b->n = 0;
+}
+
+/*
+ * trace_thread_exit - pthread key destructor: flush the exiting
+ *     thread's buffer
+ */
+static void trace_thread_exit(void *arg)
+{
+    trace_flush((tbuf_t *)arg);
+}
+
+/*
+ * trace_buf - Return the calling thread's buffer, creating it with
+ *     mmap (not malloc, which would recurse) on first use
+ */
+static tbuf_t *trace_buf(void)
+{
+    tbuf_t *b = my_buf;
+    int slot;
+
+    if (b != NULL)
+	return b;
+    b = mmap(NULL, sizeof(tbuf_t), PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (b == MAP_FAILED)
+	return NULL;
+    b->n = 0;
+    b->tid = (uint32_t)syscall(SYS_gettid);
+    my_buf = b;
+    slot = __atomic_fetch_add(&trace_nbufs, 1, __ATOMIC_RELAXED);
+    if (slot < TRACE_MAXTHREADS)
+	__atomic_store_n(&trace_bufs[slot], b, __ATOMIC_RELEASE);
+    pthread_setspecific(trace_key, b);
+    return b;
+}
+
+/*
+ * trace_next_seq - Take the next sequence number.  Called with mm_lock
+ *     held, so that sequence order is heap order.
+ */
+static uint64_t trace_next_seq(void)
+{
+    return __atomic_fetch_add(&trace_seq, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * trace_log - Append one record to the calling thread's buffer
+ */
+static void trace_log(uint64_t seq, uint32_t type, void *ptr, void *oldptr,
+		      size_t size)
+{
+    tbuf_t *b;
+    mmtrace_rec_t *r;
+
+    if ((b = trace_buf()) == NULL)
+	return;
+    r = &b->rec[b->n++];
+    r->seq = seq;
+    r->ptr = (uintptr_t)ptr;
+    r->oldptr = (uintptr_t)oldptr;
+    r->size = size;
+    r->tid = b->tid;
+    r->type = type;
+    if (b->n == TRACE_BUFRECS)
+	trace_flush(b);
+}
+
+/*
+ * Fork handlers: hold the allocator lock across fork() so the child
+ * never inherits a heap in the middle of an update.
+ */
+static void atfork_prepare(void)
+{
+    pthread_mutex_lock(&mm_lock);
+}
+
+static void atfork_parent(void)
+{
+    pthread_mutex_unlock(&mm_lock);
+}
+
+static void atfork_child(void)
+{
+    pthread_mutex_init(&mm_lock, NULL);
+    trace_fd = -1;
+    if (my_buf != NULL)
+	my_buf->n = 0;
+}
+
+/*
+ * prof_init - Start the heap profiler if MM_PROFILE is set
+ */
+static void prof_init(void)
+{
+    char *path, *rate;
+    size_t period = MMPROF_PERIOD;
+
+    if ((path = getenv("MM_PROFILE")) == NULL || *path == '\0')
+	return;
+    if ((rate = getenv("MM_PROFILE_RATE")) != NULL && atol(rate) > 0)
+	period = atol(rate);
+    if (mmprof_init(period) == 0)
+	prof_path = path;
+}
+
+/*
+ * preload_init - Library constructor: install the fork handlers, start
+ *     the profiler if MM_PROFILE is set and open the trace file if
+ *     MM_TRACE is set
+ */
+__attribute__((constructor))
+static void preload_init(void)
+{
+    char *path;
+    int fd;
+
+    pthread_atfork(atfork_prepare, atfork_parent, atfork_child);
+    prof_init();
+    if ((path = getenv("MM_TRACE")) == NULL || *path == '\0')
+	return;
+    if (pthread_key_create(&trace_key, trace_thread_exit) != 0)
+	return;
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0)
+	return;
+    write(fd, MMTRACE_MAGIC, 8);
+    trace_fd = fd;
+}
+
+EXPORT int libmm_prof_dump(const char *path);
+
+/*
+ * preload_fini - Library destructor: write the heap profile and flush
+ *     every thread's trace buffer
+ */
+__attribute__((destructor))
+static void preload_fini(void)
+{
+    int i, n;
+    tbuf_t *b;
+
+    if (prof_path != NULL)
+	libmm_prof_dump(prof_path);
+
+    if (trace_fd < 0)
+	return;
+    n = __atomic_load_n(&trace_nbufs, __ATOMIC_ACQUIRE);
+    if (n > TRACE_MAXTHREADS)
+	n = TRACE_MAXTHREADS;
+    for (i = 0; i < n; i++)
+	if ((b = __atomic_load_n(&trace_bufs[i], __ATOMIC_ACQUIRE)) != NULL)
+	    trace_flush(b);
+    close(trace_fd);
+    trace_fd = -1;
+}
+
+/*
+ * The exported allocation interface
+ */
+
+EXPORT void *malloc(size_t size)
+{
+    void *p;
+    uint64_t seq = 0;
+
+    if (size > MM_REQUEST_MAX) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    pthread_mutex_lock(&mm_lock);
+    if (!initialized)
+	heap_init();
+    p = mm_malloc(size ? size : 1);
+    if (trace_fd >= 0)
+	seq = trace_next_seq();
+    pthread_mutex_unlock(&mm_lock);
+
+    if (p == NULL)
+	errno = ENOMEM;
+    else if (trace_fd >= 0)
+	trace_log(seq, MMTRACE_ALLOC, p, NULL, size);
+    return p;
+}
+
+EXPORT void free(void *ptr)
+{
+    uint64_t seq = 0;
+
+    if (ptr == NULL || !in_heap(ptr))
+	return;
+    pthread_mutex_lock(&mm_lock);
+    mm_free(ptr);
+    if (trace_fd >= 0)
+	seq = trace_next_seq();
+    pthread_mutex_unlock(&mm_lock);
+
+    if (trace_fd >= 0)
+	trace_log(seq, MMTRACE_FREE, ptr, NULL, 0);
+}
+
+EXPORT void *realloc(void *ptr, size_t size)
+{
+    void *p;
+    uint64_t seq = 0;
+
+    if (ptr == NULL)
+	return malloc(size);
+    if (size == 0) {
+	free(ptr);
+	return NULL;
+    }
+    if (!in_heap(ptr) || size > MM_REQUEST_MAX) {
+	errno = ENOMEM;
+	return NULL;
+    }
+
+    pthread_mutex_lock(&mm_lock);
+    p = mm_realloc(ptr, size);
+    if (trace_fd >= 0)
+	seq = trace_next_seq();
+    pthread_mutex_unlock(&mm_lock);
+
+    if (p == NULL)
+	errno = ENOMEM;
+    else if (trace_fd >= 0)
+	trace_log(seq, MMTRACE_REALLOC, p, ptr, size);
+    return p;
+}
+
+EXPORT void *calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if (size != 0 && nmemb > (size_t)-1 / size) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    if ((p = malloc(nmemb * size)) != NULL)
+	memset(p, 0, nmemb * size);
+    return p;
+}
+
+EXPORT void *memalign(size_t alignment, size_t size)
+{
+    void *p;
+    uint64_t seq = 0;
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+	errno = EINVAL;
+	return NULL;
+    }
+    if (alignment > MM_REQUEST_MAX || size > MM_REQUEST_MAX - alignment) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    pthread_mutex_lock(&mm_lock);
+    if (!initialized)
+	heap_init();
+    p = mm_memalign(alignment, size ? size : 1);
+    if (trace_fd >= 0)
+	seq = trace_next_seq();
+    pthread_mutex_unlock(&mm_lock);
+
+    if (p == NULL)
+	errno = ENOMEM;
+    else if (trace_fd >= 0)
+	trace_log(seq, MMTRACE_ALLOC, p, NULL, size);
+    return p;
+}
+
+EXPORT int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *p;
+
+    if (alignment % sizeof(void *) != 0 ||
+	(alignment & (alignment - 1)) != 0)
+	return EINVAL;
+    if ((p = memalign(alignment, size)) == NULL)
+	return ENOMEM;
+    *memptr = p;
+    return 0;
+}
+
+EXPORT void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+EXPORT void *valloc(size_t size)
+{
+    return memalign(mem_pagesize(), size);
+}
+
+EXPORT void *pvalloc(size_t size)
+{
+    size_t page = mem_pagesize();
+
+    if (size > MM_REQUEST_MAX) {
+	errno = ENOMEM;
+	return NULL;
+    }
+    return memalign(page, (size + page - 1) & ~(page - 1));
+}
+
+EXPORT size_t malloc_usable_size(void *ptr)
+{
+    size_t n;
+
+    if (ptr == NULL || !in_heap(ptr))
+	return 0;
+    pthread_mutex_lock(&mm_lock);
+    n = mm_usable_size(ptr);
+    pthread_mutex_unlock(&mm_lock);
+    return n;
+}
+
+/*
+ * Heap statistics for monitoring.  libmm_stats fills in a struct
+ * mm_stats (see mm.h) under the allocator lock; malloc_stats prints a
+ * summary to stderr like the glibc function of the same name.
+ */
+
+EXPORT void libmm_stats(struct mm_stats *st)
+{
+    pthread_mutex_lock(&mm_lock);
+    if (!initialized)
+	heap_init();
+    mm_stats(st);
+    pthread_mutex_unlock(&mm_lock);
+}
+
+EXPORT void malloc_stats(void)
+{
+    struct mm_stats st;
+    char buf[256];
+    int n;
+
+    libmm_stats(&st);
+    n = snprintf(buf, sizeof(buf),
+		 "heap %zu (peak %zu), in use %zu in %zu blocks, "
+		 "free %zu in %zu blocks, largest free %zu, frag %.3f\n",
+		 st.heap_size, st.peak_heap_size, st.alloc_bytes,
+		 st.alloc_blocks, st.free_bytes, st.free_blocks,
+		 st.largest_free, st.ext_frag);
+    if (n > 0)
+	write(STDERR_FILENO, buf, n < (int)sizeof(buf) ? n : (int)sizeof(buf) - 1);
+}
+
+/*
+ * libmm_prof_dump - Write the heap profile to path.  Returns 0 on
+ *     success and -1 on error.
+ */
+EXPORT int libmm_prof_dump(const char *path)
+{
+    int fd, ret;
+
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+	return -1;
+    pthread_mutex_lock(&mm_lock);
+    ret = mmprof_dump(fd);
+    pthread_mutex_unlock(&mm_lock);
+    close(fd);
+    return ret;
+}
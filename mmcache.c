@@ -0,0 +1,455 @@
+/*
+ * mmcache.c - Thread-safe front end for mm.c with small-block caches;
+ *     see mmcache.h
+ *
+ * A cache is an array of stacks, one per size class.  Class c holds
+ * blocks whose usable size is at least 16 * (c + 1) bytes, which is
+ * what a miss asks mm.c for, so any block popped from class c fits
+ * every request that maps to it.  A freed block goes to the highest
+ * class its usable size covers.
+ *
+ * Per-CPU caches live in one mmap'ed array indexed by the CPU number
+ * that the kernel keeps in the thread's struct rseq.  A push or pop
+ * reads the CPU number, finds the stack and commits with a single
+ * store of the new count; if the thread is preempted, migrated or
+ * signalled between the start of the sequence and that store, the
+ * kernel moves it to the abort handler, which starts over.  glibc 2.35
+ * and later register a struct rseq for every thread; otherwise each
+ * thread registers its own on first use.
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if defined(__x86_64__) && defined(__linux__) && defined(__has_include)
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define HAVE_RSEQ
+#endif
+#endif
+
+#include "mm.h"
+#include "mmcache.h"
+
+/* One size class's stack of free blocks */
+typedef struct {
+    uintptr_t count;                /* stored last; commits a push/pop */
+    void *item[MMCACHE_SLOTS];
+} cstack_t;
+
+/* One CPU's or thread's cache */
+typedef struct cache {
+    cstack_t cls[MMCACHE_CLASSES];
+    struct cache *next;             /* list of thread caches */
+} __attribute__((aligned(64))) cache_t;
+
+const char *mmcache_names[] = {"none", "thread", "cpu"};
+
+static int mode = MMCACHE_NONE;
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Per-thread caches */
+static pthread_mutex_t list_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+static cache_t *thread_caches = NULL;
+static __thread cache_t *mine = NULL;
+
+/* Per-CPU caches */
+static cache_t *cpu_caches = NULL;
+static unsigned ncpus = 0;
+
+/*
+ * heap_malloc, heap_free - Call mm.c under the heap lock
+ */
+static void *heap_malloc(size_t size)
+{
+    void *bp;
+
+    pthread_mutex_lock(&heap_lock);
+    bp = mm_malloc(size);
+    pthread_mutex_unlock(&heap_lock);
+    return bp;
+}
+
+static void heap_free(void *bp)
+{
+    pthread_mutex_lock(&heap_lock);
+    mm_free(bp);
+    pthread_mutex_unlock(&heap_lock);
+}
+
+#ifdef HAVE_RSEQ
+static __thread struct rseq own_rseq;
+static __thread int own_state = 0;  /* 1 = registered, -1 = refused */
+
+/*
+ * rseq_area - Return the calling thread's registered struct rseq, or
+ *     NULL if the kernel won't give it one
+ */
+static inline struct rseq *rseq_area(void)
+{
+    struct rseq *rs;
+
+    if (__rseq_size > 0) {
+	rs = (struct rseq *)((char *)__builtin_thread_pointer() + __rseq_offset);
+	if ((int32_t)rs->cpu_id >= 0)
+	    return rs;
+    }
+    if (own_state == 0)
+	own_state = syscall(SYS_rseq, &own_rseq, sizeof(own_rseq), 0,
+			    RSEQ_SIG) == 0 ? 1 : -1;
+    return own_state > 0 ? &own_rseq : NULL;
+}
+
+/*
+ * The critical section runs from label 1 up to label 2, where the last
+ * instruction before 2 is the committing store.  Label 3 is its
+ * descriptor in __rseq_cs, and the abort handler 4, which must follow
+ * the signature the rseq area was registered with, restarts from 6.
+ */
+#define RSEQ_SIG_STR "0x53053053"   /* RSEQ_SIG for x86 */
+#define RSEQ_TABLES							\
+    ".pushsection __rseq_cs, \"aw\"\n\t"				\
+    ".balign 32\n\t"							\
+    "3:\n\t"								\
+    ".long 0, 0\n\t"							\
+    ".quad 1b, 2b - 1b, 4f\n\t"						\
+    ".popsection\n\t"							\
+    ".pushsection __rseq_failure, \"ax\"\n\t"				\
+    ".byte 0x0f, 0xb9, 0x3d\n\t"					\
+    ".long " RSEQ_SIG_STR "\n\t"					\
+    "4:\n\t"								\
+    "jmp 6b\n\t"							\
+    ".popsection\n\t"
+
+/*
+ * cpu_pop - Pop a block from size class c of the current CPU's cache,
+ *     or return NULL if that stack is empty
+ */
+static inline void *cpu_pop(struct rseq *rs, int c)
+{
+    void *bp;
+
+    __asm__ __volatile__(
+	"6:\n\t"
+	"leaq 3f(%%rip), %%rax\n\t"
+	"movq %%rax, %c[cs](%[rs])\n\t"
+	"1:\n\t"
+	"xorl %k[bp], %k[bp]\n\t"
+	"movl %c[cpu](%[rs]), %%eax\n\t"
+	"cmpl %[ncpus], %%eax\n\t"
+	"jae 2f\n\t"
+	"imulq %[stride], %%rax\n\t"
+	"addq %[base], %%rax\n\t"
+	"movq (%%rax), %%rcx\n\t"
+	"testq %%rcx, %%rcx\n\t"
+	"jz 2f\n\t"
+	"movq (%%rax,%%rcx,8), %[bp]\n\t"
+	"decq %%rcx\n\t"
+	"movq %%rcx, (%%rax)\n\t"
+	"2:\n\t"
+	RSEQ_TABLES
+	: [bp] "=&r" (bp)
+	: [rs] "r" (rs), [ncpus] "r" (ncpus),
+	  [stride] "r" ((uintptr_t)sizeof(cache_t)),
+	  [base] "r" (&cpu_caches->cls[c]),
+	  [cs] "i" (offsetof(struct rseq, rseq_cs)),
+	  [cpu] "i" (offsetof(struct rseq, cpu_id))
+	: "rax", "rcx", "cc", "memory");
+    return bp;
+}
+
+/*
+ * cpu_push - Push bp onto size class c of the current CPU's cache.
+ *     Returns 0 if that stack is full.
+ */
+static inline int cpu_push(struct rseq *rs, int c, void *bp)
+{
+    int ok;
+
+    __asm__ __volatile__(
+	"6:\n\t"
+	"leaq 3f(%%rip), %%rax\n\t"
+	"movq %%rax, %c[cs](%[rs])\n\t"
+	"1:\n\t"
+	"xorl %[ok], %[ok]\n\t"
+	"movl %c[cpu](%[rs]), %%eax\n\t"
+	"cmpl %[ncpus], %%eax\n\t"
+	"jae 2f\n\t"
+	"imulq %[stride], %%rax\n\t"
+	"addq %[base], %%rax\n\t"
+	"movq (%%rax), %%rcx\n\t"
+	"cmpq %[slots], %%rcx\n\t"
+	"jae 2f\n\t"
+	"movq %[bp], 8(%%rax,%%rcx,8)\n\t"
+	"incq %%rcx\n\t"
+	"movl $1, %[ok]\n\t"
+	"movq %%rcx, (%%rax)\n\t"
+	"2:\n\t"
+	RSEQ_TABLES
+	: [ok] "=&r" (ok)
+	: [rs] "r" (rs), [ncpus] "r" (ncpus), [bp] "r" (bp),
+	  [stride] "r" ((uintptr_t)sizeof(cache_t)),
+	  [base] "r" (&cpu_caches->cls[c]),
+	  [slots] "i" (MMCACHE_SLOTS),
+	  [cs] "i" (offsetof(struct rseq, rseq_cs)),
+	  [cpu] "i" (offsetof(struct rseq, cpu_id))
+	: "rax", "rcx", "cc", "memory");
+    return ok;
+}
+#endif /* HAVE_RSEQ */
+
+/*
+ * flush_cache - Return every block in cache to mm.c
+ */
+static void flush_cache(cache_t *cache)
+{
+    cstack_t *s;
+    int c;
+
+    pthread_mutex_lock(&heap_lock);
+    for (c = 0; c < MMCACHE_CLASSES; c++) {
+	s = &cache->cls[c];
+	while (s->count > 0)
+	    mm_free(s->item[--s->count]);
+    }
+    pthread_mutex_unlock(&heap_lock);
+}
+
+/*
+ * thread_exit - pthread key destructor: give the exiting thread's
+ *     cache back
+ */
+static void thread_exit(void *arg)
+{
+    cache_t *cache = arg, **pp;
+
+    flush_cache(cache);
+    pthread_mutex_lock(&list_lock);
+    for (pp = &thread_caches; *pp != cache; pp = &(*pp)->next)
+	;
+    *pp = cache->next;
+    pthread_mutex_unlock(&list_lock);
+    munmap(cache, sizeof(cache_t));
+    mine = NULL;
+}
+
+static void make_key(void)
+{
+    pthread_key_create(&cache_key, thread_exit);
+}
+
+/*
+ * thread_cache - Return the calling thread's cache, creating it on
+ *     first use, or NULL if it can't be allocated
+ */
+static cache_t *thread_cache(void)
+{
+    cache_t *cache;
+
+    if (mine != NULL)
+	return mine;
+    cache = mmap(NULL, sizeof(cache_t), PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (cache == MAP_FAILED)
+	return NULL;
+    pthread_once(&key_once, make_key);
+    pthread_setspecific(cache_key, cache);
+    pthread_mutex_lock(&list_lock);
+    cache->next = thread_caches;
+    thread_caches = cache;
+    pthread_mutex_unlock(&list_lock);
+    return (mine = cache);
+}
+
+/*
+ * cache_pop - Take a block of size class c from the caller's cache, or
+ *     return NULL
+ */
+static inline void *cache_pop(int c)
+{
+    cstack_t *s;
+
+#ifdef HAVE_RSEQ
+    struct rseq *rs;
+
+    if (mode == MMCACHE_CPU)
+	return (rs = rseq_area()) != NULL ? cpu_pop(rs, c) : NULL;
+#endif
+    if (mine == NULL && thread_cache() == NULL)
+	return NULL;
+    s = &mine->cls[c];
+    return s->count > 0 ? s->item[--s->count] : NULL;
+}
+
+/*
+ * cache_push - Put bp into size class c of the caller's cache.
+ *     Returns 0 if there is no room.
+ */
+static inline int cache_push(int c, void *bp)
+{
+    cstack_t *s;
+
+#ifdef HAVE_RSEQ
+    struct rseq *rs;
+
+    if (mode == MMCACHE_CPU)
+	return (rs = rseq_area()) != NULL ? cpu_push(rs, c, bp) : 0;
+#endif
+    if (mine == NULL && thread_cache() == NULL)
+	return 0;
+    s = &mine->cls[c];
+    if (s->count == MMCACHE_SLOTS)
+	return 0;
+    s->item[s->count++] = bp;
+    return 1;
+}
+
+/*
+ * mmcache_init - Start caching in the given mode, after mm_init and
+ *     while no other thread is using mmcache.  Anything already cached
+ *     is dropped, since mm_init has discarded the heap it came from.
+ *     Returns the mode actually used: MMCACHE_CPU falls back to
+ *     MMCACHE_THREAD where rseq is unavailable.
+ */
+int mmcache_init(int m)
+{
+    cache_t *cache;
+    long n;
+
+#ifdef HAVE_RSEQ
+    if (m == MMCACHE_CPU && cpu_caches == NULL) {
+	n = sysconf(_SC_NPROCESSORS_CONF);
+	ncpus = n > 0 ? (unsigned)n : 1;
+	cpu_caches = mmap(NULL, ncpus * sizeof(cache_t),
+			  PROT_READ | PROT_WRITE,
+			  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (cpu_caches == MAP_FAILED)
+	    cpu_caches = NULL;
+    }
+    if (m == MMCACHE_CPU && (cpu_caches == NULL || rseq_area() == NULL))
+	m = MMCACHE_THREAD;
+#else
+    (void)n;
+    if (m == MMCACHE_CPU)
+	m = MMCACHE_THREAD;
+#endif
+    if (cpu_caches != NULL)
+	memset(cpu_caches, 0, ncpus * sizeof(cache_t));
+    pthread_mutex_lock(&list_lock);
+    for (cache = thread_caches; cache != NULL; cache = cache->next)
+	memset(cache->cls, 0, sizeof(cache->cls));
+    pthread_mutex_unlock(&list_lock);
+    mode = m;
+    return m;
+}
+
+/*
+ * mmcache_malloc - Allocate size bytes, from the cache if it is small
+ */
+void *mmcache_malloc(size_t size)
+{
+    void *batch[MMCACHE_BATCH];
+    int c, i, n;
+
+    if (mode == MMCACHE_NONE || size == 0 || size > MMCACHE_MAX)
+	return heap_malloc(size);
+    c = (size - 1) / 16;
+    if ((batch[0] = cache_pop(c)) != NULL)
+	return batch[0];
+
+    /* Miss: fetch a batch, keep the rest for later requests */
+    pthread_mutex_lock(&heap_lock);
+    for (n = 0; n < MMCACHE_BATCH; n++)
+	if ((batch[n] = mm_malloc(16 * (c + 1))) == NULL)
+	    break;
+    pthread_mutex_unlock(&heap_lock);
+    if (n == 0)
+	return NULL;
+    for (i = 1; i < n && cache_push(c, batch[i]); i++)
+	;
+    if (i < n) {
+	pthread_mutex_lock(&heap_lock);
+	for (; i < n; i++)
+	    mm_free(batch[i]);
+	pthread_mutex_unlock(&heap_lock);
+    }
+    return batch[0];
+}
+
+/*
+ * mmcache_free - Free a block from mmcache_malloc
+ */
+void mmcache_free(void *ptr)
+{
+    void *batch[MMCACHE_BATCH];
+    size_t usable;
+    int c, n;
+
+    if (ptr == NULL)
+	return;
+    if (mode == MMCACHE_NONE) {
+	heap_free(ptr);
+	return;
+    }
+    usable = mm_usable_size(ptr);
+    c = usable / 16 - 1;
+    if (c < 0 || c >= MMCACHE_CLASSES) {
+	heap_free(ptr);
+	return;
+    }
+    if (cache_push(c, ptr))
+	return;
+
+    /* Full: hand ptr and a batch of its neighbours back to mm.c */
+    batch[0] = ptr;
+    for (n = 1; n < MMCACHE_BATCH && (batch[n] = cache_pop(c)) != NULL; n++)
+	;
+    pthread_mutex_lock(&heap_lock);
+    while (n > 0)
+	mm_free(batch[--n]);
+    pthread_mutex_unlock(&heap_lock);
+}
+
+/*
+ * mmcache_thread_flush - Return the calling thread's cached blocks to
+ *     mm.c; for a thread going idle.  Per-CPU caches are shared, so
+ *     this does nothing for them.
+ */
+void mmcache_thread_flush(void)
+{
+    if (mode == MMCACHE_THREAD && mine != NULL)
+	flush_cache(mine);
+}
+
+/*
+ * mmcache_cached_bytes - Bytes held in all caches, counting each block
+ *     at its class size.  Other threads may be changing the counts, so
+ *     the total is approximate.
+ */
+size_t mmcache_cached_bytes(void)
+{
+    cache_t *cache;
+    size_t bytes = 0;
+    unsigned i;
+    int c;
+
+    if (mode == MMCACHE_CPU) {
+	for (i = 0; i < ncpus; i++)
+	    for (c = 0; c < MMCACHE_CLASSES; c++)
+		bytes += cpu_caches[i].cls[c].count * 16 * (c + 1);
+	return bytes;
+    }
+    pthread_mutex_lock(&list_lock);
+    for (cache = thread_caches; cache != NULL; cache = cache->next)
+	for (c = 0; c < MMCACHE_CLASSES; c++)
+	    bytes += cache->cls[c].count * 16 * (c + 1);
+    pthread_mutex_unlock(&list_lock);
+    return bytes;
+}
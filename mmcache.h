@@ -0,0 +1,44 @@
+/*
+ * mmcache.h - Thread-safe front end for mm.c with small-block caches
+ *
+ * mm.c is single-threaded, so every call into it is made under one
+ * lock.  mmcache puts stacks of free small blocks in front of that
+ * lock: a request for at most MMCACHE_MAX bytes pops a block of its
+ * size class from a cache, and a free pushes the block back, so most
+ * small requests never reach mm.c.  A miss refills the stack with
+ * MMCACHE_BATCH blocks in one locked trip, and a push onto a full
+ * stack returns a batch to mm.c.
+ *
+ * The caches are either per thread or per CPU.  Per-thread caches
+ * need no synchronization, but each thread can hold up to a full set
+ * of stacks, so hundreds of mostly idle threads pin a lot of memory.
+ * Per-CPU caches bound that by the number of CPUs; they are made safe
+ * against preemption and migration with restartable sequences
+ * (Linux rseq): the push and pop are short assembly sequences that the
+ * kernel restarts if the thread is preempted or gets a signal part
+ * way through, so they need no atomic instructions.  They are only
+ * available on x86-64 Linux; elsewhere, or if the kernel refuses rseq,
+ * mmcache_init falls back to per-thread caches.
+ */
+#ifndef __MMCACHE_H_
+#define __MMCACHE_H_
+
+#include <stddef.h>
+
+#define MMCACHE_NONE    0   /* no cache; every request takes the lock */
+#define MMCACHE_THREAD  1   /* per-thread caches */
+#define MMCACHE_CPU     2   /* per-CPU caches (rseq) */
+
+#define MMCACHE_CLASSES 32  /* size classes, 16 bytes apart */
+#define MMCACHE_MAX     (16 * MMCACHE_CLASSES) /* largest cached request */
+#define MMCACHE_SLOTS   64  /* blocks per cache stack */
+#define MMCACHE_BATCH   16  /* blocks moved per trip to mm.c */
+
+int mmcache_init(int mode);
+void *mmcache_malloc(size_t size);
+void mmcache_free(void *ptr);
+void mmcache_thread_flush(void);
+size_t mmcache_cached_bytes(void);
+extern const char *mmcache_names[];
+
+#endif /* __MMCACHE_H_ */
@@ -0,0 +1,111 @@
+/*
+ * mmengine.c - Table of the allocator engines linked into mdriver;
+ *     see mmengine.h
+ */
+#define _GNU_SOURCE		/* For dladdr and dlinfo */
+#include <dlfcn.h>
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mm.h"
+#include "mmengine.h"
+
+const mm_engine_t *mm_engines[MM_ENGINE_MAX];
+int mm_num_engines = 0;
+
+/*
+ * mm_engine_register - Add e to the table, in the order registered
+ */
+void mm_engine_register(const mm_engine_t *e)
+{
+    if (mm_num_engines == MM_ENGINE_MAX || mm_engine_find(e->name) != NULL) {
+	fprintf(stderr, "mm_engine_register: can't register engine %s\n",
+		e->name);
+	exit(1);
+    }
+    mm_engines[mm_num_engines++] = e;
+}
+
+/*
+ * mm_engine_find - Return the engine called name, or NULL
+ */
+const mm_engine_t *mm_engine_find(const char *name)
+{
+    int i;
+
+    for (i = 0; i < mm_num_engines; i++)
+	if (strcmp(mm_engines[i]->name, name) == 0)
+	    return mm_engines[i];
+    return NULL;
+}
+
+/*
+ * lib_sym - Look up name in the shared object lib, whose link map is
+ *     lm.  dlsym also searches lib's dependencies, so a library without
+ *     an allocator would get libc's; returns NULL unless the symbol
+ *     found is defined in lib itself.
+ */
+static void *lib_sym(void *lib, const struct link_map *lm, const char *name)
+{
+    Dl_info info;
+    void *sym;
+
+    if ((sym = dlsym(lib, name)) == NULL)
+	return NULL;
+    if (dladdr(sym, &info) == 0 || info.dli_fbase != (void *)lm->l_addr)
+	return NULL;
+    return sym;
+}
+
+/*
+ * mm_engine_load - Load the allocator in the shared object path and
+ *     register it as an engine named after the file.  Returns the
+ *     engine, or NULL after printing why it couldn't be loaded.
+ */
+const mm_engine_t *mm_engine_load(const char *path)
+{
+    struct link_map *lm;
+    mm_engine_t *e;
+    const char *name;
+    void *lib;
+
+    if ((lib = dlopen(path, RTLD_NOW | RTLD_LOCAL)) == NULL) {
+	fprintf(stderr, "Can't load %s: %s\n", path, dlerror());
+	return NULL;
+    }
+    if (dlinfo(lib, RTLD_DI_LINKMAP, &lm) != 0) {
+	fprintf(stderr, "Can't load %s: %s\n", path, dlerror());
+	dlclose(lib);
+	return NULL;
+    }
+    if ((e = calloc(1, sizeof(mm_engine_t))) == NULL) {
+	fprintf(stderr, "Can't load %s: out of memory\n", path);
+	dlclose(lib);
+	return NULL;
+    }
+    e->malloc = (void *(*)(size_t))lib_sym(lib, lm, "malloc");
+    e->free = (void (*)(void *))lib_sym(lib, lm, "free");
+    e->realloc = (void *(*)(void *, size_t))lib_sym(lib, lm, "realloc");
+    e->usable_size = (size_t (*)(void *))lib_sym(lib, lm,
+						  "malloc_usable_size");
+    if (e->malloc == NULL || e->free == NULL || e->realloc == NULL) {
+	fprintf(stderr, "%s has no malloc, free or realloc of its own\n",
+		path);
+	free(e);
+	dlclose(lib);
+	return NULL;
+    }
+    name = strrchr(path, '/') != NULL ? strrchr(path, '/') + 1 : path;
+    if ((e->name = strdup(name)) == NULL ||
+	(e->descr = strdup(path)) == NULL) {
+	fprintf(stderr, "Can't load %s: out of memory\n", path);
+	free((char *)e->name);
+	free(e);
+	dlclose(lib);
+	return NULL;
+    }
+    mm_engine_register(e);
+    return e;
+}
@@ -0,0 +1,45 @@
+/*
+ * mmengine.h - Table of the allocator engines linked into mdriver
+ *
+ * An engine is an allocator with mm.c's interface, reached through a
+ * table of function pointers so that mdriver can run several of them
+ * over the same traces in one process.  mdriver registers the mm.o it
+ * was linked with as "mm"; every other engine is a build of mm.c in one
+ * of its modes, compiled with -DMM_ENGINE=<name> (see mm.h), which
+ * registers itself from a constructor before main runs.  The engines
+ * share memlib's heap, which mdriver resets before each mm_init.
+ *
+ * mm_engine_load registers any allocator in a shared object (a
+ * system tcmalloc or jemalloc, or libmm.so) through the malloc, free,
+ * realloc and malloc_usable_size it exports.  Such an engine has no
+ * init, checkheap or stats, and no heap in memlib: mdriver measures its
+ * utilization through the process's resident set size instead.
+ * Must be included after mm.h.
+ */
+#ifndef __MMENGINE_H_
+#define __MMENGINE_H_
+
+#include <stddef.h>
+
+#define MM_ENGINE_MAX 16        /* engines that can be registered */
+
+typedef struct {
+    const char *name;           /* for mdriver -e */
+    const char *descr;          /* one line for mdriver -h */
+    int (*init)(void);          /* NULL if loaded by mm_engine_load */
+    void *(*malloc)(size_t size);
+    void (*free)(void *ptr);
+    void *(*realloc)(void *ptr, size_t size);
+    size_t (*usable_size)(void *ptr);   /* may be NULL if loaded */
+    void (*stats)(struct mm_stats *st);
+    int (*checkheap)(int verbose);
+} mm_engine_t;
+
+extern const mm_engine_t *mm_engines[];
+extern int mm_num_engines;
+
+void mm_engine_register(const mm_engine_t *e);
+const mm_engine_t *mm_engine_find(const char *name);
+const mm_engine_t *mm_engine_load(const char *path);
+
+#endif /* __MMENGINE_H_ */
@@ -0,0 +1,302 @@
+/*
+ * mmprof.c - Sampling heap profiler for mm.c; see mmprof.h
+ *
+ * Two open-addressing hash tables are mmap'ed by mmprof_init (the
+ * profiler can't use malloc, since under libmm.so malloc is mm.c):
+ * one maps each live sampled block to its size and allocation site,
+ * and the other holds one entry per distinct call stack with its
+ * in-use and cumulative counts.  Both have a fixed size; samples that
+ * don't fit are dropped and counted in the profile header comment.
+ */
+#include <execinfo.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "mmprof.h"
+
+#define LIVE_SLOTS  (1 << 16)   /* sampled blocks tracked at once */
+#define SITE_SLOTS  (1 << 12)   /* distinct call stacks */
+
+/* A live sampled block */
+typedef struct {
+    void *bp;                   /* NULL = empty slot */
+    size_t size;                /* requested size */
+    int site;                   /* index into sites[] */
+} live_t;
+
+/* An allocation site (call stack) */
+typedef struct {
+    uint64_t hash;              /* 0 = empty slot */
+    int depth;
+    void *pc[MMPROF_DEPTH];
+    long inuse_n, inuse_bytes;  /* sampled blocks still live */
+    long alloc_n, alloc_bytes;  /* all sampled blocks */
+} site_t;
+
+long mmprof_countdown = LONG_MAX;
+size_t mmprof_nlive = 0;
+
+static live_t *live = NULL;
+static site_t *sites = NULL;
+static size_t nsites = 0;
+static size_t period = 0;       /* 0 = sampling disabled */
+static size_t dropped = 0;
+static uint64_t rng;
+
+/*
+ * next_gap - Draw the number of bytes until the next sample from an
+ *     exponential distribution with mean period
+ */
+static long next_gap(void)
+{
+    double u;
+
+    if (period == 0)
+	return LONG_MAX;
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    u = ((rng * 0x2545F4914F6CDD1DULL >> 11) + 1) * (1.0 / 9007199254740992.0);
+    return (long)(-log(u) * period) + 1;
+}
+
+/*
+ * mix - Hash a pointer-sized value
+ */
+static uint64_t mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/*
+ * live_find - Return the slot holding bp, or the empty slot where it
+ *     would go
+ */
+static live_t *live_find(void *bp)
+{
+    size_t i = mix((uintptr_t)bp) & (LIVE_SLOTS - 1);
+
+    while (live[i].bp != NULL && live[i].bp != bp)
+	i = (i + 1) & (LIVE_SLOTS - 1);
+    return &live[i];
+}
+
+/*
+ * live_remove - Empty the slot e, re-placing the rest of its cluster
+ *     so that lookups of later entries still find them
+ */
+static void live_remove(live_t *e)
+{
+    size_t i = e - live, j;
+    live_t moved;
+
+    live[i].bp = NULL;
+    for (j = (i + 1) & (LIVE_SLOTS - 1); live[j].bp != NULL;
+	 j = (j + 1) & (LIVE_SLOTS - 1)) {
+	moved = live[j];
+	live[j].bp = NULL;
+	*live_find(moved.bp) = moved;
+    }
+    mmprof_nlive--;
+}
+
+/*
+ * site_find - Return the index of the site for the call stack pc[],
+ *     adding it if it is new, or -1 if the table is full
+ */
+static int site_find(void **pc, int depth)
+{
+    uint64_t h = 0;
+    size_t i;
+    int k;
+
+    for (k = 0; k < depth; k++)
+	h = mix(h ^ (uintptr_t)pc[k]);
+    if (h == 0)
+	h = 1;
+    for (i = h & (SITE_SLOTS - 1); sites[i].hash != 0;
+	 i = (i + 1) & (SITE_SLOTS - 1))
+	if (sites[i].hash == h && sites[i].depth == depth &&
+	    memcmp(sites[i].pc, pc, depth * sizeof(void *)) == 0)
+	    return (int)i;
+    if (nsites >= SITE_SLOTS * 3 / 4)
+	return -1;
+    sites[i].hash = h;
+    sites[i].depth = depth;
+    memcpy(sites[i].pc, pc, depth * sizeof(void *));
+    nsites++;
+    return (int)i;
+}
+
+/*
+ * mmprof_init - Start sampling on average once every period bytes;
+ *     a period of 0 stops sampling.  Returns 0 on success and -1 if the
+ *     tables can't be allocated.  Must not be called from inside the
+ *     allocator, since the first backtrace() may itself call malloc.
+ */
+int mmprof_init(size_t p)
+{
+    void *pc[1];
+
+    if (live == NULL) {
+	live = mmap(NULL, LIVE_SLOTS * sizeof(live_t), PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	sites = mmap(NULL, SITE_SLOTS * sizeof(site_t), PROT_READ | PROT_WRITE,
+		     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (live == MAP_FAILED || sites == MAP_FAILED) {
+	    live = NULL;
+	    return -1;
+	}
+	backtrace(pc, 1);   /* load the unwinder now */
+    }
+    rng = mix((uint64_t)time(NULL) ^ (uintptr_t)&p) | 1;
+    period = p;
+    mmprof_countdown = next_gap();
+    return 0;
+}
+
+/*
+ * mmprof_reset - Forget every sample; called when mm_init starts a
+ *     new heap
+ */
+void mmprof_reset(void)
+{
+    if (live == NULL)
+	return;
+    memset(live, 0, LIVE_SLOTS * sizeof(live_t));
+    memset(sites, 0, SITE_SLOTS * sizeof(site_t));
+    mmprof_nlive = 0;
+    nsites = 0;
+    dropped = 0;
+}
+
+/*
+ * mmprof_sample - Record the call stack of the block bp of size bytes,
+ *     and draw the next sampling gap
+ */
+void mmprof_sample(void *bp, size_t size)
+{
+    void *pc[MMPROF_DEPTH + 1];
+    live_t *e;
+    int depth, s;
+
+    mmprof_countdown = next_gap();
+    if (live == NULL)
+	return;
+    if (mmprof_nlive >= LIVE_SLOTS * 3 / 4) {
+	dropped++;
+	return;
+    }
+    /* Leave out this function's own frame */
+    depth = backtrace(pc, MMPROF_DEPTH + 1) - 1;
+    if (depth < 0 || (s = site_find(pc + 1, depth)) < 0) {
+	dropped++;
+	return;
+    }
+    sites[s].inuse_n++;
+    sites[s].inuse_bytes += size;
+    sites[s].alloc_n++;
+    sites[s].alloc_bytes += size;
+
+    e = live_find(bp);
+    e->bp = bp;
+    e->size = size;
+    e->site = s;
+    mmprof_nlive++;
+}
+
+/*
+ * mmprof_free - Stop tracking bp if it was sampled
+ */
+void mmprof_free(void *bp)
+{
+    live_t *e = live_find(bp);
+
+    if (e->bp == NULL)
+	return;
+    sites[e->site].inuse_n--;
+    sites[e->site].inuse_bytes -= e->size;
+    live_remove(e);
+}
+
+/*
+ * mmprof_move - A sampled block now starts at newbp instead of oldbp
+ */
+void mmprof_move(void *oldbp, void *newbp)
+{
+    live_t *e = live_find(oldbp), saved;
+
+    if (e->bp == NULL)
+	return;
+    saved = *e;
+    live_remove(e);
+    saved.bp = newbp;
+    *live_find(newbp) = saved;
+    mmprof_nlive++;
+}
+
+/*
+ * mmprof_dump - Write the profile to fd.  Returns 0 on success and -1
+ *     on a write error.
+ */
+int mmprof_dump(int fd)
+{
+    char buf[4096];
+    long inuse_n = 0, inuse_bytes = 0, alloc_n = 0, alloc_bytes = 0;
+    size_t i;
+    ssize_t m;
+    int n, k, maps;
+
+    if (sites == NULL)
+	return 0;
+    for (i = 0; i < SITE_SLOTS; i++) {
+	inuse_n += sites[i].inuse_n;
+	inuse_bytes += sites[i].inuse_bytes;
+	alloc_n += sites[i].alloc_n;
+	alloc_bytes += sites[i].alloc_bytes;
+    }
+    n = snprintf(buf, sizeof(buf),
+		 "heap profile: %6ld: %8ld [%6ld: %8ld] @ heap_v2/%zu\n",
+		 inuse_n, inuse_bytes, alloc_n, alloc_bytes, period);
+    if (write(fd, buf, n) != n)
+	return -1;
+
+    for (i = 0; i < SITE_SLOTS; i++) {
+	if (sites[i].alloc_n == 0)
+	    continue;
+	n = snprintf(buf, sizeof(buf), "%6ld: %8ld [%6ld: %8ld] @",
+		     sites[i].inuse_n, sites[i].inuse_bytes,
+		     sites[i].alloc_n, sites[i].alloc_bytes);
+	for (k = 0; k < sites[i].depth; k++)
+	    n += snprintf(buf + n, sizeof(buf) - n, " %p", sites[i].pc[k]);
+	buf[n++] = '\n';
+	if (write(fd, buf, n) != n)
+	    return -1;
+    }
+
+    /* pprof symbolizes the addresses with the process's mappings */
+    n = snprintf(buf, sizeof(buf), "\nMAPPED_LIBRARIES:\n");
+    if (write(fd, buf, n) != n)
+	return -1;
+    if ((maps = open("/proc/self/maps", O_RDONLY)) >= 0) {
+	while ((m = read(maps, buf, sizeof(buf))) > 0)
+	    if (write(fd, buf, m) != m)
+		break;
+	close(maps);
+    }
+    if (dropped) {
+	n = snprintf(buf, sizeof(buf), "# %zu samples dropped\n", dropped);
+	write(fd, buf, n);
+    }
+    return 0;
+}
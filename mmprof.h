@@ -0,0 +1,39 @@
+/*
+ * mmprof.h - Sampling heap profiler for mm.c
+ *
+ * When mm.c is compiled with -DMM_PROFILE, mm_malloc charges every
+ * request against mmprof_countdown and calls mmprof_sample once the
+ * countdown goes negative.  The gap between samples is drawn from an
+ * exponential distribution with mean mmprof_init's period, so on
+ * average one sample is taken every period bytes and every byte is
+ * equally likely to be sampled.  A sampled block's call stack is
+ * recorded, and the block is tracked until it is freed.
+ *
+ * mmprof_dump writes the sampled live heap, grouped by call stack, in
+ * the legacy gperftools heap profile format ("heap_v2"), which pprof
+ * reads and scales back up to estimated totals:
+ *
+ *     pprof --text <program> <profile>
+ *
+ * None of these functions are thread-safe; mm.c's caller serializes
+ * them as it does mm_malloc and mm_free.
+ */
+#ifndef __MMPROF_H_
+#define __MMPROF_H_
+
+#include <stddef.h>
+
+#define MMPROF_DEPTH    32           /* frames kept per call stack */
+#define MMPROF_PERIOD   (512 * 1024) /* default mean bytes between samples */
+
+extern long mmprof_countdown;   /* bytes left until the next sample */
+extern size_t mmprof_nlive;     /* sampled blocks not yet freed */
+
+int mmprof_init(size_t period);
+void mmprof_reset(void);
+void mmprof_sample(void *bp, size_t size);
+void mmprof_free(void *bp);
+void mmprof_move(void *oldbp, void *newbp);
+int mmprof_dump(int fd);
+
+#endif /* __MMPROF_H_ */
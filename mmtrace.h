@@ -0,0 +1,32 @@
+/*
+ * mmtrace.h - Binary allocation trace format written by libmm.so
+ *
+ * A trace file starts with the 8-byte magic MMTRACE_MAGIC followed by
+ * fixed-size records.  Each thread appends whole buffers of records
+ * with a single write() to a file opened with O_APPEND, so records of
+ * different threads are interleaved in the file; the global order of
+ * the requests is given by the seq field.  trace2rep sorts the records
+ * and turns them into an mdriver .rep trace.
+ */
+#ifndef __MMTRACE_H_
+#define __MMTRACE_H_
+
+#include <stdint.h>
+
+#define MMTRACE_MAGIC "MMTRACE1"
+
+/* Record types */
+#define MMTRACE_ALLOC   'a'   /* malloc, calloc, memalign: ptr, size */
+#define MMTRACE_REALLOC 'r'   /* realloc: oldptr -> ptr, size */
+#define MMTRACE_FREE    'f'   /* free: ptr */
+
+typedef struct {
+    uint64_t seq;      /* position in the global order of requests */
+    uint64_t ptr;      /* block returned (alloc, realloc) or freed (free) */
+    uint64_t oldptr;   /* block passed to realloc */
+    uint64_t size;     /* requested size (alloc, realloc) */
+    uint32_t tid;      /* thread that made the request */
+    uint32_t type;     /* MMTRACE_ALLOC, MMTRACE_REALLOC or MMTRACE_FREE */
+} mmtrace_rec_t;
+
+#endif /* __MMTRACE_H_ */
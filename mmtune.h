@@ -0,0 +1,19 @@
+/*
+ * Generated by traceinfo from
+ *   traces/gen-small-lifo.rep,
+ *   traces/gen-bimodal-fifo.rep,
+ *   traces/gen-powerlaw-random.rep,
+ *   traces/gen-longlived.rep,
+ *   traces/gen-realloc.rep,
+ *   traces/gen-phases.rep
+ * Do not edit; build mm.c with -DMM_TUNE='"mmtune.h"' (see mm.h).
+ */
+
+/* Hot block sizes up to 48 bytes; the last bin starts at 402653184 */
+#define MM_SMALL_MAX  128
+
+/* 1% of requests need a smaller block */
+#define MM_SPLIT_MIN  32
+
+/* Smallest peak live payload 8532 bytes */
+#define MM_CHUNKSIZE  4096
@@ -0,0 +1,22 @@
+/* Generated by mksizetab from mm.h; do not edit. */
+
+/* Block size and first bin, by (request + DSIZE - 1) / DSIZE */
+static const struct {
+	unsigned short asize;
+	unsigned char bin;
+} size_classes[9] = {
+	{32, 0},
+	{32, 0},
+	{48, 1},
+	{64, 2},
+	{80, 3},
+	{96, 4},
+	{112, 5},
+	{128, 6},
+	{144, 6},
+};
+
+/* Bin of a free block, by size / DSIZE */
+static const unsigned char size_bins[8] = {
+	0, 0, 0, 1, 2, 3, 4, 5,
+};
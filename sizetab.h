@@ -0,0 +1,47 @@
+/* Generated by mksizetab from mm.h; do not edit. */
+
+/* Block size and first bin, by (request + DSIZE - 1) / DSIZE */
+static const struct {
+	unsigned short asize;
+	unsigned char bin;
+} size_classes[33] = {
+	{32, 0},
+	{32, 0},
+	{48, 1},
+	{64, 2},
+	{80, 3},
+	{96, 4},
+	{112, 5},
+	{128, 6},
+	{144, 7},
+	{160, 8},
+	{176, 9},
+	{192, 10},
+	{208, 11},
+	{224, 12},
+	{240, 13},
+	{256, 14},
+	{272, 15},
+	{288, 16},
+	{304, 17},
+	{320, 18},
+	{336, 19},
+	{352, 20},
+	{368, 21},
+	{384, 22},
+	{400, 23},
+	{416, 24},
+	{432, 25},
+	{448, 26},
+	{464, 27},
+	{480, 28},
+	{496, 29},
+	{512, 30},
+	{528, 30},
+};
+
+/* Bin of a free block, by size / DSIZE */
+static const unsigned char size_bins[32] = {
+	0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+	14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29,
+};
@@ -0,0 +1,269 @@
+/*
+ * trace2rep.c - Convert a binary trace written by libmm.so (MM_TRACE)
+ *     into an mdriver .rep trace
+ *
+ * Usage: trace2rep <binary trace> [<output .rep>]
+ *
+ * Records are sorted by sequence number, and each address handed out
+ * by the allocator is mapped to a trace id for as long as it is live.
+ * Requests that can't be replayed are dropped: frees and reallocs of
+ * blocks allocated before logging started, and requests too large for
+ * the int sizes of the .rep format.  Blocks still live at the end of
+ * the log get a free, so the trace is balanced like the -bal traces.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "mmtrace.h"
+
+/* Open-addressing map from live block address to trace id */
+typedef struct {
+    uint64_t ptr;   /* 0 = empty slot */
+    int id;
+} entry_t;
+
+static entry_t *map;
+static size_t map_cap;
+
+/* Output requests */
+typedef struct {
+    char type;
+    int id;
+    int size;
+} op_t;
+
+static op_t *ops;
+static size_t nops, ops_cap;
+static int *live;          /* live[id] != 0 while id is allocated */
+static int nids;
+static size_t ids_cap;
+static long cur_bytes, peak_bytes;
+static long *sizes;
+
+/*
+ * hash - Mix the address bits into a map index
+ */
+static size_t hash(uint64_t p)
+{
+    p ^= p >> 33;
+    p *= 0xff51afd7ed558ccdULL;
+    p ^= p >> 33;
+    return (size_t)p & (map_cap - 1);
+}
+
+/*
+ * map_find - Return the slot holding ptr, or the empty slot where it
+ *     would go
+ */
+static entry_t *map_find(uint64_t ptr)
+{
+    size_t i = hash(ptr);
+
+    while (map[i].ptr != 0 && map[i].ptr != ptr)
+	i = (i + 1) & (map_cap - 1);
+    return &map[i];
+}
+
+/*
+ * map_remove - Remove the entry e, re-placing the rest of its cluster
+ *     so that lookups of later entries still find them
+ */
+static void map_remove(entry_t *e)
+{
+    size_t i = e - map, j;
+    entry_t moved;
+
+    map[i].ptr = 0;
+    for (j = (i + 1) & (map_cap - 1); map[j].ptr != 0;
+	 j = (j + 1) & (map_cap - 1)) {
+	moved = map[j];
+	map[j].ptr = 0;
+	*map_find(moved.ptr) = moved;
+    }
+}
+
+/*
+ * new_id - Start tracking a new block of size bytes
+ */
+static int new_id(long size)
+{
+    if ((size_t)nids == ids_cap) {
+	ids_cap = ids_cap ? 2 * ids_cap : 1024;
+	live = realloc(live, ids_cap * sizeof(int));
+	sizes = realloc(sizes, ids_cap * sizeof(long));
+	if (live == NULL || sizes == NULL) {
+	    fprintf(stderr, "trace2rep: out of memory\n");
+	    exit(1);
+	}
+    }
+    live[nids] = 1;
+    sizes[nids] = size;
+    return nids++;
+}
+
+/*
+ * emit - Append a request to the output
+ */
+static void emit(char type, int id, long size)
+{
+    if (nops == ops_cap) {
+	ops_cap = ops_cap ? 2 * ops_cap : 4096;
+	if ((ops = realloc(ops, ops_cap * sizeof(op_t))) == NULL) {
+	    fprintf(stderr, "trace2rep: out of memory\n");
+	    exit(1);
+	}
+    }
+    ops[nops].type = type;
+    ops[nops].id = id;
+    ops[nops].size = (int)size;
+    nops++;
+    if (type == 'f')
+	cur_bytes -= sizes[id];
+    else if (type == 'r') {
+	cur_bytes += size - sizes[id];
+	sizes[id] = size;
+    }
+    else
+	cur_bytes += size;
+    if (cur_bytes > peak_bytes)
+	peak_bytes = cur_bytes;
+}
+
+/*
+ * cmp_seq - qsort comparator ordering records by sequence number
+ */
+static int cmp_seq(const void *a, const void *b)
+{
+    uint64_t x = ((const mmtrace_rec_t *)a)->seq;
+    uint64_t y = ((const mmtrace_rec_t *)b)->seq;
+
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in, *out = stdout;
+    char magic[8];
+    mmtrace_rec_t *recs = NULL, *r;
+    size_t nrecs = 0, cap = 0, i, dropped = 0;
+    entry_t *e;
+    int id;
+
+    if (argc < 2 || argc > 3) {
+	fprintf(stderr, "Usage: trace2rep <binary trace> [<output .rep>]\n");
+	exit(1);
+    }
+    if ((in = fopen(argv[1], "rb")) == NULL) {
+	perror(argv[1]);
+	exit(1);
+    }
+    if (fread(magic, 1, 8, in) != 8 || memcmp(magic, MMTRACE_MAGIC, 8) != 0) {
+	fprintf(stderr, "trace2rep: %s is not an mm trace\n", argv[1]);
+	exit(1);
+    }
+
+    /* Read every record, then restore the global request order */
+    for (;;) {
+	if (nrecs == cap) {
+	    cap = cap ? 2 * cap : 65536;
+	    if ((recs = realloc(recs, cap * sizeof(mmtrace_rec_t))) == NULL) {
+		fprintf(stderr, "trace2rep: out of memory\n");
+		exit(1);
+	    }
+	}
+	if (fread(&recs[nrecs], sizeof(mmtrace_rec_t), 1, in) != 1)
+	    break;
+	nrecs++;
+    }
+    fclose(in);
+    qsort(recs, nrecs, sizeof(mmtrace_rec_t), cmp_seq);
+
+    for (map_cap = 1024; map_cap < 2 * nrecs; map_cap *= 2)
+	;
+    if ((map = calloc(map_cap, sizeof(entry_t))) == NULL) {
+	fprintf(stderr, "trace2rep: out of memory\n");
+	exit(1);
+    }
+
+    for (i = 0; i < nrecs; i++) {
+	r = &recs[i];
+	switch (r->type) {
+	case MMTRACE_ALLOC:
+	    if (r->size > INT_MAX) {
+		dropped++;
+		break;
+	    }
+	    e = map_find(r->ptr);
+	    if (e->ptr != 0) /* missed free of a block from before logging */
+		live[e->id] = 0;
+	    /* mdriver can't replay malloc(0); libmm.so served it as 1 byte */
+	    id = new_id(r->size ? (long)r->size : 1);
+	    e->ptr = r->ptr;
+	    e->id = id;
+	    emit('a', id, sizes[id]);
+	    break;
+
+	case MMTRACE_REALLOC:
+	    e = map_find(r->oldptr);
+	    if (e->ptr == 0 || r->size > INT_MAX) {
+		dropped++;
+		break;
+	    }
+	    id = e->id;
+	    map_remove(e);
+	    e = map_find(r->ptr);
+	    e->ptr = r->ptr;
+	    e->id = id;
+	    emit('r', id, (long)r->size);
+	    break;
+
+	case MMTRACE_FREE:
+	    e = map_find(r->ptr);
+	    if (e->ptr == 0) {
+		dropped++;
+		break;
+	    }
+	    id = e->id;
+	    map_remove(e);
+	    live[id] = 0;
+	    emit('f', id, 0);
+	    break;
+
+	default:
+	    fprintf(stderr, "trace2rep: bad record type %u\n", r->type);
+	    exit(1);
+	}
+    }
+
+    /* Balance the trace */
+    for (id = 0; id < nids; id++)
+	if (live[id]) {
+	    live[id] = 0;
+	    emit('f', id, 0);
+	}
+
+    if (nids == 0) {
+	fprintf(stderr, "trace2rep: no replayable requests in %s\n", argv[1]);
+	exit(1);
+    }
+    if (argc == 3 && (out = fopen(argv[2], "w")) == NULL) {
+	perror(argv[2]);
+	exit(1);
+    }
+    fprintf(out, "%ld\n%d\n%zu\n%d\n", peak_bytes, nids, nops, 1);
+    for (i = 0; i < nops; i++) {
+	if (ops[i].type == 'f')
+	    fprintf(out, "f %d\n", ops[i].id);
+	else
+	    fprintf(out, "%c %d %d\n", ops[i].type, ops[i].id, ops[i].size);
+    }
+    if (out != stdout)
+	fclose(out);
+    if (dropped)
+	fprintf(stderr, "trace2rep: dropped %zu requests that can't be replayed\n",
+		dropped);
+    return 0;
+}
@@ -0,0 +1,437 @@
+/*
+ * tracegen.c - Synthetic trace generator for the malloc lab driver
+ *
+ * Emits a .rep trace (the format read by read_trace() in mdriver.c)
+ * from a parameterized model of a program's allocation behavior:
+ *
+ *   - a size distribution:   fixed:N            every request is N bytes
+ *                            uniform:LO,HI      uniform in [LO, HI]
+ *                            bimodal:A,B,P      A with probability P, else B
+ *                            powerlaw:LO,HI,ALPHA
+ *                                               truncated Pareto on [LO, HI]
+ *   - a lifetime model that decides which live block the next free
+ *     releases:              lifo               most recently allocated
+ *                            fifo               least recently allocated
+ *                            random             uniformly chosen
+ *                            longlived:F        random, but a fraction F
+ *                                               of blocks live to the end
+ *   - realloc growth chains: with probability P an op grows a live
+ *                            block by a factor G (-r P,G)
+ *   - phases:                -z and -l may be repeated; the trace is cut
+ *                            into as many equal phases as the longer
+ *                            list, and phase i uses the i-th entry of
+ *                            each list (the last entry repeats)
+ *
+ * The generator is driven by its own xorshift64* PRNG, so a given seed
+ * and set of parameters produces the same trace on every platform.  All
+ * blocks are freed by the end of the trace, like the "-bal" traces, so
+ * the trace can come out one request shorter than asked for (an odd
+ * count without reallocs, for example).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <math.h>
+
+#define MAXPHASES 16
+#define MAXREQ    (1 << 20)  /* realloc chains restart beyond this size */
+#define CHAIN_P   0.8        /* probability a realloc continues the chain */
+
+/* Size distribution of one phase */
+typedef struct {
+    enum {FIXED, UNIFORM, BIMODAL, POWERLAW} kind;
+    double a, b, c;
+} sizedist_t;
+
+/* Lifetime model of one phase */
+typedef struct {
+    enum {LIFO, FIFO, RANDOM, LONGLIVED} kind;
+    double frac;  /* fraction of long-lived blocks (LONGLIVED only) */
+} lifetime_t;
+
+/* One generated request, as it will be written to the trace */
+typedef struct {
+    char type;     /* 'a', 'r' or 'f' */
+    int id;
+    int size;
+} op_t;
+
+/* Generator state */
+static uint64_t rng_state;
+static op_t *ops;          /* generated requests */
+static int nops;
+static int *order;         /* live ids in allocation order (-1 = freed) */
+static int order_head, order_len, order_dead;
+static int *sizes;         /* current size of each id */
+static char *immortal;     /* id lives until the final drain */
+static int nids, maxids;
+static int nlive, nmortal;
+static int chain_id = -1;  /* block grown by the last realloc */
+static long live_bytes, peak_bytes;
+
+/*
+ * rng_next - xorshift64*
+ */
+static uint64_t rng_next(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ * rng_unit - uniform double in [0, 1)
+ */
+static double rng_unit(void)
+{
+    return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * draw_size - Draw a request size from distribution d
+ */
+static int draw_size(sizedist_t *d)
+{
+    double u, lo, hi, x;
+
+    switch (d->kind) {
+    case FIXED:
+	return (int)d->a;
+    case UNIFORM:
+	return (int)(d->a + rng_unit() * (d->b - d->a + 1));
+    case BIMODAL:
+	return (int)((rng_unit() < d->c) ? d->a : d->b);
+    case POWERLAW:
+	/* Inverse CDF of the Pareto distribution truncated to [lo, hi] */
+	lo = d->a;
+	hi = d->b;
+	u = rng_unit();
+	x = pow(lo, -d->c) - u * (pow(lo, -d->c) - pow(hi, -d->c));
+	return (int)pow(x, -1.0 / d->c);
+    }
+    return 1;
+}
+
+/*
+ * emit - Append a request to the trace
+ */
+static void emit(char type, int id, int size)
+{
+    ops[nops].type = type;
+    ops[nops].id = id;
+    ops[nops].size = size;
+    nops++;
+}
+
+/*
+ * compact_order - Squeeze freed entries out of order[]
+ */
+static void compact_order(void)
+{
+    int i, n = 0;
+
+    for (i = order_head; i < order_len; i++)
+	if (order[i] >= 0)
+	    order[n++] = order[i];
+    order_head = 0;
+    order_len = n;
+    order_dead = 0;
+}
+
+/*
+ * do_alloc - Allocate a new id from distribution d
+ */
+static void do_alloc(sizedist_t *d, lifetime_t *l)
+{
+    int id = nids++;
+    int size = draw_size(d);
+
+    if (size < 1)
+	size = 1;
+    sizes[id] = size;
+    immortal[id] = (l->kind == LONGLIVED && rng_unit() < l->frac);
+    order[order_len++] = id;
+    nlive++;
+    nmortal += !immortal[id];
+    live_bytes += size;
+    if (live_bytes > peak_bytes)
+	peak_bytes = live_bytes;
+    emit('a', id, size);
+}
+
+/*
+ * do_free - Free the live id at position pos in order[]
+ */
+static void do_free(int pos)
+{
+    int id = order[pos];
+
+    order[pos] = -1;
+    order_dead++;
+    nlive--;
+    nmortal -= !immortal[id];
+    live_bytes -= sizes[id];
+    if (id == chain_id)
+	chain_id = -1;
+    emit('f', id, 0);
+    if (order_dead > 64 && order_dead > (order_len - order_head) / 2)
+	compact_order();
+}
+
+/*
+ * pick_victim - Choose the position in order[] of the block to free
+ * next, honoring the lifetime model.  Long-lived blocks are skipped
+ * unless drain is set.
+ */
+static int pick_victim(lifetime_t *l, int drain)
+{
+    int pos, span;
+
+    if (l->kind == LIFO && !drain) {
+	for (pos = order_len - 1; pos >= order_head; pos--)
+	    if (order[pos] >= 0 && !immortal[order[pos]])
+		return pos;
+    }
+    if (l->kind == FIFO || drain) {
+	while (order_head < order_len && order[order_head] < 0) {
+	    order_head++;
+	    order_dead--;
+	}
+	for (pos = order_head; pos < order_len; pos++)
+	    if (order[pos] >= 0 && (drain || !immortal[order[pos]]))
+		return pos;
+    }
+
+    /* RANDOM and LONGLIVED: rejection-sample a mortal live entry */
+    span = order_len - order_head;
+    for (;;) {
+	pos = order_head + (int)(rng_unit() * span);
+	if (order[pos] >= 0 && !immortal[order[pos]])
+	    return pos;
+    }
+}
+
+/*
+ * do_realloc - Grow a live block by factor growth.  Usually this is the
+ * block grown by the previous realloc, so that consecutive reallocs
+ * form chains like a growing buffer; otherwise a new chain starts at a
+ * random live block.
+ */
+static void do_realloc(double growth)
+{
+    int pos, id, newsize;
+    int span = order_len - order_head;
+
+    id = chain_id;
+    if (id < 0 || rng_unit() >= CHAIN_P ||
+	(int)(sizes[id] * growth) + 1 > MAXREQ) {
+	do {
+	    pos = order_head + (int)(rng_unit() * span);
+	} while (order[pos] < 0);
+	id = order[pos];
+    }
+    chain_id = id;
+    newsize = (int)(sizes[id] * growth) + 1;
+    if (newsize > MAXREQ)
+	newsize = MAXREQ;
+    live_bytes += newsize - sizes[id];
+    if (live_bytes > peak_bytes)
+	peak_bytes = live_bytes;
+    sizes[id] = newsize;
+    emit('r', id, newsize);
+}
+
+/*
+ * parse_size - Parse a size distribution spec
+ */
+static int parse_size(char *spec, sizedist_t *d)
+{
+    d->a = d->b = d->c = 0;
+    if (sscanf(spec, "fixed:%lf", &d->a) == 1)
+	d->kind = FIXED;
+    else if (sscanf(spec, "uniform:%lf,%lf", &d->a, &d->b) == 2)
+	d->kind = UNIFORM;
+    else if (sscanf(spec, "bimodal:%lf,%lf,%lf", &d->a, &d->b, &d->c) == 3)
+	d->kind = BIMODAL;
+    else if (sscanf(spec, "powerlaw:%lf,%lf,%lf", &d->a, &d->b, &d->c) == 3)
+	d->kind = POWERLAW;
+    else
+	return 0;
+    if (d->a < 1 || (d->kind != FIXED && d->kind != BIMODAL && d->b < d->a))
+	return 0;
+    return !(d->kind == POWERLAW && d->c <= 0);
+}
+
+/*
+ * parse_lifetime - Parse a lifetime model spec
+ */
+static int parse_lifetime(char *spec, lifetime_t *l)
+{
+    l->frac = 0;
+    if (!strcmp(spec, "lifo"))
+	l->kind = LIFO;
+    else if (!strcmp(spec, "fifo"))
+	l->kind = FIFO;
+    else if (!strcmp(spec, "random"))
+	l->kind = RANDOM;
+    else if (sscanf(spec, "longlived:%lf", &l->frac) == 1)
+	l->kind = LONGLIVED;
+    else
+	return 0;
+    return 1;
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: tracegen [-h] [-s <seed>] [-n <ops>] [-L <maxlive>]\n"
+	    "                [-z <sizes>]... [-l <lifetime>]... [-r <p>,<growth>]"
+	    " [-o <file>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h           Print this message.\n");
+    fprintf(stderr, "\t-l <model>   Lifetime model: lifo, fifo, random, longlived:F.\n");
+    fprintf(stderr, "\t-L <n>       At most n blocks live at once (default 1000).\n");
+    fprintf(stderr, "\t-n <ops>     Number of requests to generate (default 10000).\n");
+    fprintf(stderr, "\t-o <file>    Write the trace to <file> instead of stdout.\n");
+    fprintf(stderr, "\t-r <p>,<g>   Each op is a realloc growing a block by g with\n"
+	    "\t             probability p.\n");
+    fprintf(stderr, "\t-s <seed>    Seed of the generator (default 1).\n");
+    fprintf(stderr, "\t-z <dist>    Size distribution: fixed:N, uniform:LO,HI,\n"
+	    "\t             bimodal:A,B,P, powerlaw:LO,HI,ALPHA.\n");
+    fprintf(stderr, "\t-z and -l may be repeated to define successive phases.\n");
+}
+
+int main(int argc, char **argv)
+{
+    sizedist_t dist[MAXPHASES];
+    lifetime_t life[MAXPHASES];
+    int ndist = 0, nlife = 0, nphases;
+    unsigned long long seed = 1;
+    int target = 10000, maxlive = 1000;
+    double realloc_p = 0, growth = 1.5;
+    char *outname = NULL;
+    FILE *out = stdout;
+    int c, i, phase, remaining;
+    sizedist_t *d;
+    lifetime_t *l;
+
+    while ((c = getopt(argc, argv, "hs:n:L:z:l:r:o:")) != EOF) {
+	switch (c) {
+	case 's':
+	    seed = strtoull(optarg, NULL, 0);
+	    break;
+	case 'n':
+	    target = atoi(optarg);
+	    break;
+	case 'L':
+	    maxlive = atoi(optarg);
+	    break;
+	case 'z':
+	    if (ndist == MAXPHASES || !parse_size(optarg, &dist[ndist++])) {
+		fprintf(stderr, "tracegen: bad size distribution %s\n", optarg);
+		exit(1);
+	    }
+	    break;
+	case 'l':
+	    if (nlife == MAXPHASES || !parse_lifetime(optarg, &life[nlife++])) {
+		fprintf(stderr, "tracegen: bad lifetime model %s\n", optarg);
+		exit(1);
+	    }
+	    break;
+	case 'r':
+	    if (sscanf(optarg, "%lf,%lf", &realloc_p, &growth) != 2 ||
+		realloc_p < 0 || realloc_p >= 1 || growth <= 0) {
+		fprintf(stderr, "tracegen: bad realloc spec %s\n", optarg);
+		exit(1);
+	    }
+	    break;
+	case 'o':
+	    outname = optarg;
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (target < 2 || maxlive < 1) {
+	fprintf(stderr, "tracegen: need -n >= 2 and -L >= 1\n");
+	exit(1);
+    }
+    if (ndist == 0)
+	parse_size("uniform:1,4096", &dist[ndist++]);
+    if (nlife == 0)
+	parse_lifetime("random", &life[nlife++]);
+    nphases = (ndist > nlife) ? ndist : nlife;
+
+    /* A trace can't hold more allocations than half its ops */
+    maxids = target / 2 + 1;
+    ops = malloc(target * sizeof(op_t));
+    order = malloc(maxids * sizeof(int));
+    sizes = malloc(maxids * sizeof(int));
+    immortal = calloc(maxids, 1);
+    if (!ops || !order || !sizes || !immortal) {
+	fprintf(stderr, "tracegen: out of memory\n");
+	exit(1);
+    }
+    rng_state = seed ? seed : 1;
+    for (i = 0; i < 8; i++)
+	rng_next();
+
+    /*
+     * Generate the requests.  Every live block needs a free before the
+     * end, so once the remaining budget only covers those frees we
+     * switch to draining.  If one op is left with nothing live, the
+     * trace ends one op short of the target instead.
+     */
+    while (nops < target) {
+	phase = (int)((long)nops * nphases / target);
+	d = &dist[(phase < ndist) ? phase : ndist - 1];
+	l = &life[(phase < nlife) ? phase : nlife - 1];
+	remaining = target - nops;
+
+	if (remaining <= nlive) {
+	    do_free(pick_victim(l, 1));
+	}
+	else if (nlive == 0 && remaining == 1) {
+	    break;	/* an alloc here could not be freed */
+	}
+	else if (nlive > 0 && realloc_p > 0 && remaining > nlive + 1 &&
+		 rng_unit() < realloc_p) {
+	    do_realloc(growth);
+	}
+	else if (nlive == 0 || (nlive < maxlive && nids < maxids - 1 &&
+				remaining > nlive + 1 &&
+				(nmortal == 0 || rng_unit() < 0.5))) {
+	    do_alloc(d, l);
+	}
+	else if (nmortal > 0) {
+	    do_free(pick_victim(l, 0));
+	}
+	else {
+	    do_free(pick_victim(l, 1));
+	}
+    }
+
+    if (outname != NULL && (out = fopen(outname, "w")) == NULL) {
+	perror(outname);
+	exit(1);
+    }
+    fprintf(out, "%ld\n%d\n%d\n%d\n", peak_bytes, nids, nops, 1);
+    for (i = 0; i < nops; i++) {
+	if (ops[i].type == 'f')
+	    fprintf(out, "f %d\n", ops[i].id);
+	else
+	    fprintf(out, "%c %d %d\n", ops[i].type, ops[i].id, ops[i].size);
+    }
+    if (out != stdout)
+	fclose(out);
+    return 0;
+}
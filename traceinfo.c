@@ -0,0 +1,371 @@
+/*
+ * traceinfo.c - Describe the requests in .rep traces and recommend
+ *     size class parameters for mm.c
+ *
+ * Usage: traceinfo [-H <header>] <trace.rep>...
+ *
+ * Reads traces in the format read by read_trace() in mdriver.c and
+ * prints, over all of them together:
+ *
+ *   - the request sizes of allocs and reallocs, by power of two,
+ *   - the hot sizes, the exact sizes that make up at least HOT_PCT
+ *     percent of the requests,
+ *   - block lifetimes, the number of requests from a block's alloc to
+ *     its free,
+ *   - realloc chains, the number of reallocs each block gets, and how
+ *     much they grow it,
+ *   - the peak live payload of each trace.
+ *
+ * From these it derives the parameters that mm.h and mm.c take from a
+ * header named by -DMM_TUNE (see mm.h), prints them with the reason
+ * for each, and with -H writes them to that header:
+ *
+ *   MM_SMALL_MAX  every hot block size below 512 bytes gets its own
+ *                 bin; the rest of the 50 bins are spread over the
+ *                 larger sizes, so a smaller value covers more of them
+ *   MM_SPLIT_MIN  place() doesn't split off remainders smaller than
+ *                 the block that SPLIT_PCT percent of requests fit in,
+ *                 since few requests could ever reuse them
+ *   MM_CHUNKSIZE  the heap is extended by at least this much; the part
+ *                 of the last extension not yet in use is at most one
+ *                 chunk, so the chunk is kept below 1/CHUNK_DIV of the
+ *                 smallest peak among the traces
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "mm.h"
+
+#define NBUCKETS   32       /* power-of-two histogram buckets */
+#define HOT_PCT    1.0      /* share of requests that makes a size hot */
+#define NHOT       12       /* hot sizes printed */
+#define SPLIT_PCT  1.0      /* percentile of block sizes for MM_SPLIT_MIN */
+#define CHUNK_DIV  64       /* largest chunk, as a fraction of the peak */
+#define CHUNK_MIN  (1 << 12)
+#define CHUNK_MAX  (1 << 20)
+
+/* Totals over all traces */
+static long nalloc, nrealloc, nfree, nleft;
+static long size_hist[NBUCKETS];     /* requests by ceil(log2(size)) */
+static long life_hist[NBUCKETS];     /* freed blocks by floor(log2(ops)) */
+static long chain_hist[NBUCKETS];    /* blocks by ceil(log2(reallocs)) */
+static long ngrow, nshrink;
+static double log_growth;            /* sum of log(new / old size) */
+static int *reqs;                    /* every request size */
+static long nreqs, reqs_cap;
+static long min_peak = -1, max_peak;
+
+/*
+ * bucket - Index of the power-of-two bucket that holds n:
+ *     ceil(log2(n)) if up, else floor(log2(n))
+ */
+static int bucket(long n, int up)
+{
+    int b = 0;
+
+    if (n <= 1)
+	return 0;
+    b = MM_LOG2(n);
+    if (up && (n & (n - 1)) != 0)
+	b++;
+    return (b < NBUCKETS) ? b : NBUCKETS - 1;
+}
+
+/*
+ * add_request - Count a request for size bytes
+ */
+static void add_request(int size)
+{
+    if (nreqs == reqs_cap) {
+	reqs_cap = reqs_cap ? 2 * reqs_cap : 1 << 16;
+	if ((reqs = realloc(reqs, reqs_cap * sizeof(int))) == NULL) {
+	    fprintf(stderr, "traceinfo: out of memory\n");
+	    exit(1);
+	}
+    }
+    reqs[nreqs++] = size;
+    size_hist[bucket(size, 1)]++;
+}
+
+/*
+ * read_trace - Add the requests of the trace in path to the totals and
+ *     print its peak live payload.  Returns 0 on success and -1 if the
+ *     file can't be read or isn't a trace.
+ */
+static int read_trace(const char *path)
+{
+    FILE *f;
+    unsigned heapsize, num_ids, num_ops, weight, i;
+    long *born, live = 0, peak = 0;
+    int *size, *chain, id, n;
+    char type[2];
+
+    if ((f = fopen(path, "r")) == NULL) {
+	perror(path);
+	return -1;
+    }
+    if (fscanf(f, "%u %u %u %u", &heapsize, &num_ids, &num_ops,
+	       &weight) != 4) {
+	fprintf(stderr, "traceinfo: %s is not a trace\n", path);
+	fclose(f);
+	return -1;
+    }
+    born = calloc(num_ids, sizeof(long));
+    size = calloc(num_ids, sizeof(int));
+    chain = calloc(num_ids, sizeof(int));
+    if (!born || !size || !chain) {
+	fprintf(stderr, "traceinfo: out of memory\n");
+	exit(1);
+    }
+    for (i = 0; i < num_ids; i++)
+	born[i] = -1;
+
+    for (i = 0; i < num_ops; i++) {
+	if (fscanf(f, "%1s %d", type, &id) != 2 || id < 0 ||
+	    (unsigned)id >= num_ids ||
+	    (type[0] != 'f' && fscanf(f, "%d", &n) != 1)) {
+	    fprintf(stderr, "traceinfo: bad request %u in %s\n", i + 1, path);
+	    fclose(f);
+	    return -1;
+	}
+	switch (type[0]) {
+	case 'a':
+	    nalloc++;
+	    add_request(n);
+	    born[id] = i;
+	    size[id] = n;
+	    chain[id] = 0;
+	    live += n;
+	    break;
+	case 'r':
+	    nrealloc++;
+	    add_request(n);
+	    if (n > size[id])
+		ngrow++;
+	    else if (n < size[id])
+		nshrink++;
+	    if (size[id] > 0 && n > 0)
+		log_growth += log((double)n / size[id]);
+	    live += n - size[id];
+	    size[id] = n;
+	    chain[id]++;
+	    break;
+	case 'f':
+	    nfree++;
+	    if (born[id] >= 0) {
+		life_hist[bucket(i - born[id], 0)]++;
+		if (chain[id] > 0)
+		    chain_hist[bucket(chain[id], 1)]++;
+		live -= size[id];
+		size[id] = 0;
+		born[id] = -1;
+	    }
+	    break;
+	default:
+	    fprintf(stderr, "traceinfo: bad request type %c in %s\n",
+		    type[0], path);
+	    fclose(f);
+	    return -1;
+	}
+	if (live > peak)
+	    peak = live;
+    }
+    fclose(f);
+
+    for (i = 0; i < num_ids; i++)
+	if (born[i] >= 0) {
+	    nleft++;
+	    if (chain[i] > 0)
+		chain_hist[bucket(chain[i], 1)]++;
+	}
+    free(born);
+    free(size);
+    free(chain);
+
+    printf("%-36s %10u ops %12ld peak bytes\n", path, num_ops, peak);
+    if (min_peak < 0 || peak < min_peak)
+	min_peak = peak;
+    if (peak > max_peak)
+	max_peak = peak;
+    return 0;
+}
+
+/*
+ * print_hist - Print the non-empty buckets of a power-of-two histogram
+ *     as ranges [2^(b-1)+1, 2^b] if up, else [2^b, 2^(b+1)-1]
+ */
+static void print_hist(const char *title, long *hist, int up)
+{
+    long total = 0, sum = 0, lo, hi;
+    int b;
+
+    for (b = 0; b < NBUCKETS; b++)
+	total += hist[b];
+    printf("\n%s\n", title);
+    if (total == 0) {
+	printf("  (none)\n");
+	return;
+    }
+    for (b = 0; b < NBUCKETS; b++) {
+	if (hist[b] == 0)
+	    continue;
+	sum += hist[b];
+	lo = up ? (b == 0 ? 0 : (1L << (b - 1)) + 1) : (b == 0 ? 0 : 1L << b);
+	hi = up ? 1L << b : (1L << (b + 1)) - 1;
+	printf("  %8ld - %-8ld %10ld %6.1f%% %6.1f%%\n", lo, hi, hist[b],
+	       100.0 * hist[b] / total, 100.0 * sum / total);
+    }
+}
+
+/*
+ * cmp_int - qsort comparison for ints
+ */
+static int cmp_int(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void)
+{
+    fprintf(stderr, "Usage: traceinfo [-h] [-H <header>] <trace.rep>...\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h           Print this message.\n");
+    fprintf(stderr, "\t-H <header>  Write the recommended parameters to "
+	    "<header>,\n\t             for building mm.c with "
+	    "-DMM_TUNE='\"<header>\"'.\n");
+}
+
+int main(int argc, char **argv)
+{
+    char *header = NULL;
+    FILE *out;
+    long i, j, hot_max = 0, small_max, split_min, chunk, last_bin;
+    long ntop = 0;
+    int c, k;
+    struct { int size; long n; } top[NHOT];
+
+    while ((c = getopt(argc, argv, "hH:")) != EOF) {
+	switch (c) {
+	case 'H':
+	    header = optarg;
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (optind == argc) {
+	usage();
+	exit(1);
+    }
+
+    for (k = optind; k < argc; k++)
+	if (read_trace(argv[k]) < 0)
+	    exit(1);
+    if (nreqs == 0) {
+	fprintf(stderr, "traceinfo: no allocation requests\n");
+	exit(1);
+    }
+    printf("\n%ld allocs, %ld reallocs, %ld frees, %ld blocks never freed\n",
+	   nalloc, nrealloc, nfree, nleft);
+
+    print_hist("Request sizes (bytes)       requests  share    cum", size_hist, 1);
+
+    /* Hot sizes: runs of equal sizes in the sorted requests */
+    qsort(reqs, nreqs, sizeof(int), cmp_int);
+    for (i = 0; i < nreqs; i = j) {
+	for (j = i; j < nreqs && reqs[j] == reqs[i]; j++)
+	    ;
+	if (100.0 * (j - i) < HOT_PCT * nreqs)
+	    continue;
+	if (reqs[i] > 0 && MM_CLASS_SIZE((size_t)reqs[i]) < 512 &&
+	    (long)MM_CLASS_SIZE((size_t)reqs[i]) > hot_max)
+	    hot_max = MM_CLASS_SIZE((size_t)reqs[i]);
+	/* Keep the NHOT most frequent, in decreasing order */
+	for (k = ntop < NHOT ? ntop++ : NHOT;
+	     k > 0 && top[k - 1].n < j - i; k--)
+	    if (k < NHOT)
+		top[k] = top[k - 1];
+	if (k < NHOT) {
+	    top[k].size = reqs[i];
+	    top[k].n = j - i;
+	}
+    }
+    printf("\nHot sizes (at least %.0f%% of requests each)\n", HOT_PCT);
+    if (ntop == 0)
+	printf("  (none)\n");
+    for (k = 0; k < ntop; k++)
+	printf("  %8d bytes %10ld %6.1f%%\n", top[k].size, top[k].n,
+	       100.0 * top[k].n / nreqs);
+
+    print_hist("Lifetimes (requests)        blocks    share    cum", life_hist, 0);
+    print_hist("Realloc chains (reallocs)   blocks    share    cum", chain_hist, 1);
+    if (nrealloc > 0)
+	printf("  %ld grow, %ld shrink, mean growth x%.2f per realloc\n",
+	       ngrow, nshrink, exp(log_growth / nrealloc));
+
+    /*
+     * MM_SMALL_MAX: the smallest power of two above every hot block
+     * size, from 128 up to the 512 of the default build (at 1024 the
+     * exact bins alone would outnumber MM_NBINS)
+     */
+    for (small_max = 128; small_max < 512 && small_max <= hot_max;
+	 small_max *= 2)
+	;
+    k = MM_NBINS - 1 - ((int)(small_max / MM_DSIZE) - 2);
+    last_bin = (small_max << (k / 2)) / 2 * (k % 2 ? 3 : 2);
+
+    /* MM_SPLIT_MIN: the SPLIT_PCT percentile of the block sizes */
+    i = (long)(SPLIT_PCT / 100 * nreqs);
+    split_min = MM_CLASS_SIZE((size_t)(reqs[i] > 0 ? reqs[i] : 1));
+    if (split_min < (long)(2 * MM_DSIZE))
+	split_min = 2 * MM_DSIZE;
+
+    /* MM_CHUNKSIZE: a power of two at most 1/CHUNK_DIV of the peak */
+    for (chunk = CHUNK_MIN; chunk < CHUNK_MAX && 2 * chunk <= min_peak / CHUNK_DIV;
+	 chunk *= 2)
+	;
+
+    printf("\nRecommended parameters\n");
+    printf("  MM_SMALL_MAX  %7ld  hot block sizes up to %ld bytes; "
+	   "the last bin starts at %ld\n", small_max, hot_max, last_bin);
+    printf("  MM_SPLIT_MIN  %7ld  %.0f%% of requests need a smaller block\n",
+	   split_min, SPLIT_PCT);
+    printf("  MM_CHUNKSIZE  %7ld  smallest peak %ld bytes, largest %ld\n",
+	   chunk, min_peak, max_peak);
+
+    if (header == NULL)
+	return 0;
+    if ((out = fopen(header, "w")) == NULL) {
+	perror(header);
+	exit(1);
+    }
+    fprintf(out, "/*\n * Generated by traceinfo from");
+    for (k = optind; k < argc; k++)
+	fprintf(out, "%s%s", k == optind ? "\n *   " : ",\n *   ", argv[k]);
+    fprintf(out, "\n * Do not edit; build mm.c with -DMM_TUNE='\"%s\"' "
+	    "(see mm.h).\n */\n\n", header);
+    fprintf(out, "/* Hot block sizes up to %ld bytes; the last bin starts "
+	    "at %ld */\n", hot_max, last_bin);
+    fprintf(out, "#define MM_SMALL_MAX  %ld\n\n", small_max);
+    fprintf(out, "/* %.0f%% of requests need a smaller block */\n", SPLIT_PCT);
+    fprintf(out, "#define MM_SPLIT_MIN  %ld\n\n", split_min);
+    fprintf(out, "/* Smallest peak live payload %ld bytes */\n", min_peak);
+    fprintf(out, "#define MM_CHUNKSIZE  %ld\n", chunk);
+    if (fclose(out) != 0) {
+	perror(header);
+	exit(1);
+    }
+    return 0;
+}